@@ -0,0 +1,138 @@
+/**
+ *  \file
+ *  \brief  Batch query output parser
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2022 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cstdlib>
+#include "BatchParser.h"
+
+
+namespace GTags
+{
+
+// Keeps the command line well below the CreateProcess limit
+const size_t BatchParser::cMaxQueryLen = 8192;
+
+
+/**
+ *  \brief  Combines the tags starting from first into a single "^(tag1|tag2|...)$" regexp query.
+ *          Returns the index of the first tag that didn't fit in the query.
+ */
+size_t BatchParser::ComposeQuery(const std::vector<CText>& tags, CText& query, size_t first)
+{
+    static const TCHAR cSpecialChars[] = _T("\\.^$|()[]{}*+?");
+
+    query = _T("^(");
+
+    size_t i;
+    for (i = first; i < tags.size(); ++i)
+    {
+        if (i > first && query.Len() + tags[i].Len() * 2 + 3 > cMaxQueryLen)
+            break;
+
+        if (i > first)
+            query += _T('|');
+
+        for (const TCHAR* pCh = tags[i].C_str(); *pCh; ++pCh)
+        {
+            if (_tcschr(cSpecialChars, *pCh))
+                query += _T('\\');
+            query += *pCh;
+        }
+    }
+
+    query += _T(")$");
+
+    return i;
+}
+
+
+/**
+ *  \brief  Parses ctags format output - "tag<TAB>file<TAB>line". Unlike the other formats its fields
+ *          are not padded with spaces so file names with spaces in them are read as they are.
+ */
+intptr_t BatchParser::Parse(const CmdPtr_t& cmd)
+{
+    _results.clear();
+
+    const char* pSrc = cmd->Result();
+    intptr_t entries = 0;
+
+    while (*pSrc)
+    {
+        const char* pEol = pSrc;
+        while (*pEol != '\n' && *pEol != '\r' && *pEol != 0)
+            ++pEol;
+
+        if (pEol > pSrc)
+        {
+            if (!parseLine(pSrc, pEol - pSrc))
+                return -1;
+
+            ++entries;
+        }
+
+        pSrc = pEol;
+        while (*pSrc == '\n' || *pSrc == '\r')
+            ++pSrc;
+    }
+
+    return entries;
+}
+
+
+/**
+ *  \brief
+ */
+bool BatchParser::parseLine(const char* pLine, size_t len)
+{
+    const char* pEnd = pLine + len;
+
+    const char* pTag = pLine;
+    while (pLine < pEnd && *pLine != '\t')
+        ++pLine;
+    const size_t tagLen = pLine - pTag;
+
+    if (pLine == pEnd)
+        return false;
+
+    const char* pFile = ++pLine;
+
+    // Line number is the last field - the file is everything up to it
+    const char* pNum = pEnd;
+    while (pNum > pFile && *(pNum - 1) != '\t')
+        --pNum;
+
+    if (tagLen == 0 || pNum <= pFile + 1)
+        return false;
+
+    char* pNumEnd;
+    const intptr_t lineNum = (intptr_t)strtoll(pNum, &pNumEnd, 10);
+    if (pNumEnd == pNum || pNumEnd != pEnd)
+        return false;
+
+    _results[std::string(pTag, tagLen)].emplace_back(pFile, pNum - 1 - pFile, lineNum);
+
+    return true;
+}
+
+} // namespace GTags
@@ -0,0 +1,79 @@
+/**
+ *  \file
+ *  \brief  Batch query output parser
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2022 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include "Common.h"
+#include "Cmd.h"
+
+
+namespace GTags
+{
+
+/**
+ *  \class  BatchParser
+ *  \brief  Splits the output of a batch (many tags in one regexp) query back into per tag results
+ */
+class BatchParser : public ResultParser
+{
+public:
+    struct Location
+    {
+        Location(const char* pFile, size_t len, intptr_t lineNum) : file(pFile, len), line(lineNum) {}
+
+        std::string file;
+        intptr_t    line;
+    };
+
+    typedef std::unordered_map<std::string, std::vector<Location>> Results_t;
+
+    static const size_t cMaxQueryLen;
+
+    static size_t ComposeQuery(const std::vector<CText>& tags, CText& query, size_t first = 0);
+
+    BatchParser() {}
+    virtual ~BatchParser() {}
+
+    virtual intptr_t Parse(const CmdPtr_t&);
+
+    inline const Results_t& GetResults() const { return _results; }
+
+    inline const std::vector<Location>* GetResults(const std::string& tag) const
+    {
+        Results_t::const_iterator res = _results.find(tag);
+        return (res != _results.end()) ? &res->second : NULL;
+    }
+
+private:
+    bool parseLine(const char* pLine, size_t len);
+
+    Results_t _results;
+};
+
+} // namespace GTags
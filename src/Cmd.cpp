@@ -40,6 +40,7 @@ const TCHAR* Cmd::CmdName[] = {
     _T("Find Symbol"),                  // FIND_SYMBOL
     _T("Search in Source Files"),       // GREP
     _T("Search in Other Files"),        // GREP_TEXT
+    _T("Batch Definition"),             // BATCH_DEFINITION
     _T("About"),                        // VERSION
     _T("About CTags")                   // CTAGS_VERSION
 };
@@ -51,13 +52,87 @@ const TCHAR* Cmd::CmdName[] = {
 Cmd::Cmd(CmdId_t id, DbHandle db, ParserPtr_t parser,
         const TCHAR* tag, bool ignoreCase, bool regExp) :
         _id(id), _db(db), _parser(parser),
-        _ignoreCase(ignoreCase), _regExp(regExp), _skipLibs(false), _status(CANCELLED)
+        _ignoreCase(ignoreCase), _regExp(regExp), _skipLibs(false), _speculative(false), _maxHits(0), _deadline(0),
+        _group(-1), _generation(0), _status(CANCELLED), _streamedLen(0), _truncated(false), _partial(false),
+        _cached(false), _outputBytes(0), _outputLines(0)
 {
+    for (int i = 0; i < STAGES_COUNT; ++i)
+        _stamps[i] = 0;
+
+    Stamp(CREATED);
+
     if (tag)
         _tag = tag;
 }
 
 
+/**
+ *  \brief
+ */
+LONGLONG Cmd::frequency()
+{
+    static LONGLONG freq = 0;
+
+    if (freq == 0)
+    {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        freq = f.QuadPart;
+    }
+
+    return freq;
+}
+
+
+/**
+ *  \brief
+ */
+LONGLONG Cmd::Now()
+{
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+
+    return now.QuadPart;
+}
+
+
+/**
+ *  \brief
+ */
+uint64_t Cmd::ToUs(LONGLONG ticks)
+{
+    const LONGLONG freq = frequency();
+
+    if (freq <= 0 || ticks <= 0)
+        return 0;
+
+    return (uint64_t)(ticks / freq * 1000000 + (ticks % freq) * 1000000 / freq);
+}
+
+
+/**
+ *  \brief
+ */
+LONGLONG Cmd::FromUs(uint64_t us)
+{
+    const LONGLONG freq = frequency();
+
+    return (LONGLONG)(us / 1000000) * freq + (LONGLONG)(us % 1000000) * freq / 1000000;
+}
+
+
+/**
+ *  \brief  Returns the time between the two stages in microseconds, 0 if any of them hasn't been reached
+ */
+uint64_t Cmd::ElapsedUs(Stage_t from, Stage_t to) const
+{
+    if (_stamps[from] == 0 || _stamps[to] == 0)
+        return 0;
+
+    return ToUs(_stamps[to] - _stamps[from]);
+}
+
+
 void Cmd::AppendToResult(const std::vector<char>& data)
 {
     // remove \0 string termination
@@ -66,4 +141,13 @@ void Cmd::AppendToResult(const std::vector<char>& data)
     _result.insert(_result.cend(), data.begin(), data.end());
 }
 
+
+void Cmd::AppendToResult(std::vector<char>&& data)
+{
+    if (_result.empty())
+        _result = std::move(data);
+    else
+        AppendToResult(static_cast<const std::vector<char>&>(data));
+}
+
 } // namespace GTags
@@ -29,6 +29,7 @@
 #include <tchar.h>
 #include <cstdint>
 #include <vector>
+#include <utility>
 #include "Common.h"
 #include "CmdDefines.h"
 #include "DbManager.h"
@@ -50,6 +51,19 @@ public:
     virtual ~ResultParser() {}
 
     virtual intptr_t Parse(const CmdPtr_t&) = 0;
+
+    // Streaming parsers get the command output line by line while the command is still running
+    virtual bool IsStreaming() const { return false; }
+    virtual void Begin(const CmdPtr_t&) {}
+    virtual bool ParseLine(const CmdPtr_t&, char*, size_t) { return false; }
+    virtual intptr_t End(const CmdPtr_t&) { return -1; }
+
+    // Copy of the parsed results for another command, NULL if the parser can't be copied
+    virtual ParserPtr_t Clone() const { return ParserPtr_t(); }
+
+    // Memory taken by the parsed results
+    virtual size_t MemSize() const { return _buf.Size() + _lines.capacity() * sizeof(TCHAR*); }
+
     virtual const CTextA& GetText() const { return _buf; }
     virtual const std::vector<TCHAR*>& GetList() const { return _lines; }
 
@@ -68,6 +82,22 @@ class Cmd
 public:
     static const TCHAR* CmdName[];
 
+    // Command processing stages, time stamped with the performance counter
+    enum Stage_t
+    {
+        CREATED = 0,
+        PROCESS_STARTED,
+        FIRST_BYTE,
+        END_OF_OUTPUT,
+        PARSE_DONE,
+        SHOWN,
+        STAGES_COUNT
+    };
+
+    static LONGLONG Now();
+    static uint64_t ToUs(LONGLONG ticks);
+    static LONGLONG FromUs(uint64_t us);
+
     Cmd(CmdId_t id, DbHandle db = NULL, ParserPtr_t parser = ParserPtr_t(NULL),
             const TCHAR* tag = NULL, bool ignoreCase = false, bool regExp = false);
     ~Cmd() {}
@@ -94,21 +124,63 @@ public:
     inline void SkipLibs(bool skipLibs) { _skipLibs = skipLibs; }
     inline bool SkipLibs() const { return _skipLibs; }
 
+    // Output lines limit, 0 means the default limit for the command type
+    inline void MaxHits(size_t maxHits) { _maxHits = maxHits; }
+    inline size_t MaxHits() const { return _maxHits; }
+    inline bool IsTruncated() const { return _truncated; }
+
+    // Time limit in ms from CmdEngine::Run() (queue wait included), 0 means the default limit for
+    // the command type, INFINITE - no limit. Output read till the limit is delivered as partial result.
+    inline void Deadline(DWORD deadline) { _deadline = deadline; }
+    inline DWORD Deadline() const { return _deadline; }
+    inline bool IsPartial() const { return _partial; }
+
+    // Results that might not be used - not shown while running
+    inline void Speculative(bool speculative) { _speculative = speculative; }
+    inline bool IsSpeculative() const { return _speculative; }
+
+    // Results restored from the cache
+    inline bool IsCached() const { return _cached; }
+
     inline void Status(CmdStatus_t stat) { _status = stat; }
     inline CmdStatus_t Status() const { return _status; }
 
+    inline unsigned Generation() const { return _generation; }
+
+    // at = 0 means now
+    inline void Stamp(Stage_t stage, LONGLONG at = 0) { _stamps[stage] = at ? at : Now(); }
+    inline LONGLONG Timestamp(Stage_t stage) const { return _stamps[stage]; }
+    uint64_t ElapsedUs(Stage_t from, Stage_t to) const;
+
+    // Process output size as read from the pipe
+    inline uint64_t OutputBytes() const { return _outputBytes; }
+    inline size_t OutputLines() const { return _outputLines; }
+
     inline char* Result() { return _result.data(); }
     inline const char* Result() const { return _result.data(); }
     inline size_t ResultLen() const { return _result.size() - 1; }
+    inline bool HasResult() const { return (!_result.empty() || _streamedLen); }
 
     void AppendToResult(const std::vector<char>& data);
+    void AppendToResult(std::vector<char>&& data);
+
     void SetResult(const std::vector<char>& data)
     {
         _result.assign(data.begin(), data.end());
     }
 
+    // Takes over the data buffer without copying
+    void SetResult(std::vector<char>&& data)
+    {
+        _result = std::move(data);
+    }
+
 private:
     friend class CmdEngine;
+    friend class ResultCache;
+    friend class CmdTrace;
+
+    static LONGLONG frequency();
 
     CmdId_t             _id;
     DbHandle            _db;
@@ -118,9 +190,23 @@ private:
     bool                _ignoreCase;
     bool                _regExp;
     bool                _skipLibs;
+    bool                _speculative;
+    size_t              _maxHits;
+    DWORD               _deadline;
+
+    int                 _group;
+    unsigned            _generation;
 
     CmdStatus_t         _status;
     std::vector<char>   _result;
+    size_t              _streamedLen;
+    bool                _truncated;
+    bool                _partial;
+    bool                _cached;
+
+    LONGLONG            _stamps[STAGES_COUNT];
+    uint64_t            _outputBytes;
+    size_t              _outputLines;
 };
 
 } // namespace GTags
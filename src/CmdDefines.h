@@ -44,6 +44,7 @@ enum CmdId_t
     FIND_SYMBOL,
     GREP,
     GREP_TEXT,
+    BATCH_DEFINITION,
     VERSION,
     CTAGS_VERSION
 };
@@ -52,6 +53,7 @@ enum CmdId_t
 enum CmdStatus_t
 {
     CANCELLED = 0,
+    SUPERSEDED,
     RUN_ERROR,
     FAILED,
     PARSE_ERROR,
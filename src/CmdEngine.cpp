@@ -24,7 +24,12 @@
 
 #include <windows.h>
 #include <tchar.h>
-#include <process.h>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <typeinfo>
+#include <new>
+#include <malloc.h>
 #include "Common.h"
 #include "INpp.h"
 #include "Config.h"
@@ -32,6 +37,8 @@
 #include "ReadPipe.h"
 #include "CmdEngine.h"
 #include "Cmd.h"
+#include "ResultCache.h"
+#include "CmdTrace.h"
 
 
 namespace GTags
@@ -49,24 +56,68 @@ const TCHAR* CmdEngine::CmdLine[] = {
     _T("\"%s\\global.exe\" -s --result=grep \"%s\""),                       // FIND_SYMBOL
     _T("\"%s\\global.exe\" -g --result=grep \"%s\""),                       // GREP
     _T("\"%s\\global.exe\" -gO --result=grep \"%s\""),                      // GREP_TEXT
+    _T("\"%s\\global.exe\" -dT --result=ctags \"%s\""),                     // BATCH_DEFINITION
     _T("\"%s\\global.exe\" --version"),                                     // VERSION
     _T("\"%s\\ctags.exe\" --version")                                       // CTAGS_VERSION
 };
 
+const DWORD CmdEngine::cProgressPeriod = 100;
+
+// Max time to read the output left in the pipes after the process has ended
+const DWORD CmdEngine::cOutputDrainTime = 2000;
+
+// Past all the command Ids
+const int CmdEngine::cSpeculativeGroup = CTAGS_VERSION + 1;
+
+Mutex                   CmdEngine::RunningLock;
+std::list<CmdEngine*>   CmdEngine::Running;
+std::map<int, unsigned> CmdEngine::Generations;
+std::list<CmdEngine::Join> CmdEngine::Joins;
+CmdEngine::CompletionQueue CmdEngine::Completions;
+HANDLE                  CmdEngine::StopEvent = NULL;
+
 
 /**
- *  \brief
+ *  \brief  Starts the command. The completion callback is always called later from the UI message
+ *          loop - even for results found in cache - so the command status and results are not
+ *          to be checked after this returns.
  */
 bool CmdEngine::Run(const CmdPtr_t& cmd, CompletionCB complCB)
 {
     if (!complCB)
         return false;
 
+    if (cmd->MaxHits() == 0)
+        cmd->MaxHits(MaxHits(cmd->Id()));
+
+    if (cmd->Deadline() == 0)
+        cmd->Deadline(Deadline(cmd->Id()));
+
+    if (StopEvent == NULL)
+        StopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+    // The same command is running already - just wait for its result
+    if (attach(cmd, complCB))
+        return true;
+
     CmdEngine* engine = new CmdEngine(cmd, complCB);
     cmd->Status(RUN_ERROR);
 
-    engine->_hThread = (HANDLE)_beginthreadex(NULL, 0, threadFunc, engine, 0, NULL);
-    if (engine->_hThread == NULL)
+    if (!engine->supersede())
+    {
+        cmd->Status(SUPERSEDED);
+        delete engine;
+        return false;
+    }
+
+    // Same search done already and its database is unchanged - complete right away with the cached results
+    if (ResultCache::Get().Lookup(cmd))
+    {
+        delete engine;
+        return true;
+    }
+
+    if (!ThreadPool::Get().Enqueue(lane(cmd->Id()), taskFunc, engine))
     {
         delete engine;
         return false;
@@ -76,11 +127,144 @@ bool CmdEngine::Run(const CmdPtr_t& cmd, CompletionCB complCB)
 }
 
 
+/**
+ *  \brief  Runs the command together with the same command of joinedId. Their outputs are merged and
+ *          parsed by the command parser once both complete. As Run() always completes through the
+ *          completion queue - even if the command fails to start - the completion callback is always
+ *          called later as well.
+ */
+bool CmdEngine::RunJoined(const CmdPtr_t& cmd, CmdId_t joinedId, CompletionCB complCB)
+{
+    if (!complCB)
+        return false;
+
+    CmdPtr_t joinedCmd(new Cmd(joinedId, cmd->_db, NULL, cmd->_tag.C_str(), cmd->_ignoreCase, cmd->_regExp));
+    joinedCmd->_skipLibs = cmd->_skipLibs;
+
+    Joins.push_back(Join{cmd, joinedCmd, cmd->_parser, complCB, 2});
+    std::list<Join>::iterator join = std::prev(Joins.end());
+
+    cmd->_parser.reset();
+
+    // The joined command is not run - the first command completion alone ends the join
+    if (!Run(cmd, joinCB))
+    {
+        --join->pending;
+        return false;
+    }
+
+    // Both are the same request - the joined command shouldn't supersede the first one
+    joinedCmd->_group = cmd->_group;
+    joinedCmd->_generation = cmd->_generation;
+
+    // The joined command status tells the failure when merging
+    Run(joinedCmd, joinCB);
+
+    return true;
+}
+
+
+/**
+ *  \brief  Makes the running or queued command terminate as superseded. Commands that others are
+ *          attached to are left running as their results are still needed.
+ */
+bool CmdEngine::Cancel(const CmdPtr_t& cmd)
+{
+    AUTOLOCK(RunningLock);
+
+    for (CmdEngine* engine : Running)
+    {
+        if (engine->_cmd == cmd)
+        {
+            if (!engine->_attached.empty())
+                return false;
+
+            SetEvent(engine->_hSupersede);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ *  \brief  Makes the running and the queued commands terminate as cancelled. Used on plugin
+ *          unload so the worker threads can be waited for.
+ */
+void CmdEngine::CancelAll()
+{
+    if (StopEvent)
+        SetEvent(StopEvent);
+}
+
+
+/**
+ *  \brief  Returns the configured output lines limit for the command type, 0 means no limit
+ */
+size_t CmdEngine::MaxHits(CmdId_t id)
+{
+    switch (id)
+    {
+        case FIND_FILE:
+            return GTagsSettings._maxFileHits;
+
+        case FIND_DEFINITION:
+        case FIND_REFERENCE:
+        case FIND_SYMBOL:
+            return GTagsSettings._maxFindHits;
+
+        case GREP:
+        case GREP_TEXT:
+            return GTagsSettings._maxGrepHits;
+
+        default:
+            return 0;
+    }
+}
+
+
+/**
+ *  \brief  Returns the configured time limit in ms for the command type, INFINITE means no limit
+ */
+DWORD CmdEngine::Deadline(CmdId_t id)
+{
+    unsigned deadline = 0;
+
+    switch (id)
+    {
+        case AUTOCOMPLETE:
+        case AUTOCOMPLETE_SYMBOL:
+        case AUTOCOMPLETE_FILE:
+            deadline = GTagsSettings._complDeadline;
+            break;
+
+        case FIND_FILE:
+        case FIND_DEFINITION:
+        case FIND_REFERENCE:
+        case FIND_SYMBOL:
+            deadline = GTagsSettings._findDeadline;
+            break;
+
+        case GREP:
+        case GREP_TEXT:
+            deadline = GTagsSettings._grepDeadline;
+            break;
+
+        default:
+            break;
+    }
+
+    return deadline ? deadline : INFINITE;
+}
+
+
 /**
  *  \brief
  */
 CmdEngine::CmdEngine(const CmdPtr_t& cmd, CompletionCB complCB) :
-    _cmd(cmd), _complCB(complCB), _hThread(NULL)
+    _cmd(cmd), _complCB(complCB), _hSupersede(NULL), _hProcess(NULL), _runTime(GetTickCount()), _lines(0),
+    _parseError(false), _progressive(false), _notifiedLen(0), _recording(false)
 {
 }
 
@@ -90,24 +274,418 @@ CmdEngine::CmdEngine(const CmdPtr_t& cmd, CompletionCB complCB) :
  */
 CmdEngine::~CmdEngine()
 {
-    SendMessage(MainWndH, WM_RUN_CMD_CALLBACK, (WPARAM)_complCB, (LPARAM)(&_cmd));
+    if (_hSupersede)
+    {
+        {
+            AUTOLOCK(RunningLock);
+            Running.remove(this);
+        }
+
+        CloseHandle(_hSupersede);
+    }
+
+    // Running is left so nothing can be attached anymore. The results are shared before any of the
+    // callbacks is called as they might re-run their command.
+    // Each command gets its own copy of the parsed results so the results window can tell their tabs
+    // apart. Parsers that can't be copied are not changed once parsed and are shared instead.
+    // Streamed output is kept by the parser only.
+    const bool streamed = (_cmd->_status == OK && _cmd->_parser && _cmd->_parser->IsStreaming());
+
+    for (Attached& attached : _attached)
+    {
+        Cmd& cmd = *attached.cmd;
+
+        cmd._group          = _cmd->_group;
+        cmd._generation     = _cmd->_generation;
+        cmd._status         = _cmd->_status;
+
+        if (_cmd->_parser)
+        {
+            cmd._parser = _cmd->_parser->Clone();
+            if (!cmd._parser)
+                cmd._parser = _cmd->_parser;
+        }
+        else
+        {
+            cmd._parser.reset();
+        }
+
+        if (!streamed)
+            cmd._result = _cmd->_result;
+
+        cmd._streamedLen    = _cmd->_streamedLen;
+        cmd._truncated      = _cmd->_truncated;
+        cmd._partial        = _cmd->_partial;
+        cmd._outputBytes    = _cmd->_outputBytes;
+        cmd._outputLines    = _cmd->_outputLines;
+
+        for (int i = Cmd::PROCESS_STARTED; i <= Cmd::PARSE_DONE; ++i)
+            cmd._stamps[i] = _cmd->_stamps[i];
+    }
+
+    // Replayed commands are completed by the replay driver directly
+    if (_complCB)
+        Completions.Push(_cmd, _complCB);
+
+    for (Attached& attached : _attached)
+        Completions.Push(attached.cmd, attached.complCB);
+}
+
+
+/**
+ *  \brief  Undelivered completions are dropped
+ */
+CmdEngine::CompletionQueue::~CompletionQueue()
+{
+    for (PSLIST_ENTRY entry = InterlockedFlushSList(&_head); entry;)
+    {
+        Completion* completion = CONTAINING_RECORD(entry, Completion, entry);
+        entry = entry->Next;
+
+        release(completion);
+    }
+}
+
+
+/**
+ *  \brief  Called from the command threads, never blocks
+ */
+void CmdEngine::CompletionQueue::Push(const CmdPtr_t& cmd, CompletionCB complCB)
+{
+    void* mem = _aligned_malloc(sizeof(Completion), MEMORY_ALLOCATION_ALIGNMENT);
+    if (!mem)
+        return;
+
+    Completion* completion = new (mem) Completion;
+    completion->cmd = cmd;
+    completion->complCB = complCB;
+
+    InterlockedPushEntrySList(&_head, &completion->entry);
+
+    // The UI thread hasn't got to the previous message yet - it will take this completion as well
+    if (InterlockedExchange(&_posted, 1) == 0)
+        PostMessage(MainWndH, WM_RUN_CMD_CALLBACK, 0, 0);
+}
+
+
+/**
+ *  \brief  Runs the queued completion callbacks in the order the commands have finished
+ */
+void CmdEngine::CompletionQueue::Deliver()
+{
+    // Completions queued from now on need another message
+    InterlockedExchange(&_posted, 0);
 
-    if (_hThread)
-        CloseHandle(_hThread);
+    PSLIST_ENTRY entry = reverse(InterlockedFlushSList(&_head));
+
+    while (entry)
+    {
+        Completion* completion = CONTAINING_RECORD(entry, Completion, entry);
+        entry = entry->Next;
+
+        const CmdPtr_t cmd = completion->cmd;
+        const CompletionCB complCB = completion->complCB;
+
+        release(completion);
+
+        if (complCB && cmd)
+            complCB(cmd);
+    }
+}
+
+
+/**
+ *  \brief  The list is LIFO - reverse it to get the completion order
+ */
+PSLIST_ENTRY CmdEngine::CompletionQueue::reverse(PSLIST_ENTRY entry)
+{
+    PSLIST_ENTRY reversed = NULL;
+
+    while (entry)
+    {
+        PSLIST_ENTRY next = entry->Next;
+        entry->Next = reversed;
+        reversed = entry;
+        entry = next;
+    }
+
+    return reversed;
 }
 
 
 /**
  *  \brief
  */
-unsigned __stdcall CmdEngine::threadFunc(void* data)
+void CmdEngine::CompletionQueue::release(Completion* completion)
+{
+    completion->~Completion();
+    _aligned_free(completion);
+}
+
+
+/**
+ *  \brief
+ */
+void CmdEngine::taskFunc(void* data)
 {
     CmdEngine* engine = static_cast<CmdEngine*>(data);
-    unsigned r = engine->start();
+    engine->start();
 
     delete engine;
+}
+
+
+/**
+ *  \brief  Feeds the streaming parser with the command output lines as they come
+ */
+void CmdEngine::lineCB(void* context, char* line, size_t len)
+{
+    CmdEngine* engine = static_cast<CmdEngine*>(context);
+
+    // Lines that were still in the pipe when the deadline passed are dropped
+    if (engine->_cmd->_truncated || engine->_cmd->_partial)
+        return;
+
+    if (len)
+    {
+        // Limit reached and there is more - stop the process, the rest can be loaded on demand later
+        if (engine->_cmd->_maxHits && engine->_lines == engine->_cmd->_maxHits)
+        {
+            engine->_cmd->_truncated = true;
+            TerminateProcess(engine->_hProcess, 0);
+            return;
+        }
 
-    return r;
+        ++engine->_lines;
+    }
+
+    // Only the accepted lines are recorded - the status flags tell the rest
+    if (engine->_recording)
+    {
+        engine->_traceOut.insert(engine->_traceOut.end(), line, line + len);
+        engine->_traceOut.push_back('\n');
+    }
+
+    engine->_cmd->_streamedLen += len + 1;
+
+    if (!engine->_parseError && !engine->_cmd->_parser->ParseLine(engine->_cmd, line, len))
+        engine->_parseError = true;
+}
+
+
+/**
+ *  \brief  Called on the UI thread for each of the joined commands. Merges the outputs when both are
+ *          complete and calls the actual completion callback.
+ */
+void CmdEngine::joinCB(const CmdPtr_t& cmd)
+{
+    std::list<Join>::iterator join;
+
+    for (join = Joins.begin(); join != Joins.end(); ++join)
+        if (join->cmd == cmd || join->joinedCmd == cmd)
+            break;
+
+    if (join == Joins.end() || --join->pending)
+        return;
+
+    const CmdPtr_t c = join->cmd;
+    const CmdPtr_t j = join->joinedCmd;
+    const CompletionCB complCB = join->complCB;
+
+    c->_parser = join->parser;
+
+    Joins.erase(join);
+
+    c->_outputBytes += j->_outputBytes;
+    c->_outputLines += j->_outputLines;
+    c->_partial = c->_partial || j->_partial;
+
+    if (c->_status == OK && j->_status != OK)
+    {
+        c->_status = j->_status;
+        c->_result = std::move(j->_result);
+    }
+    else if (c->_status == OK)
+    {
+        if (c->_result.empty())
+        {
+            c->_result = std::move(j->_result);
+        }
+        else if (!j->_result.empty())
+        {
+            c->_result.back() = '\n';
+            c->_result.insert(c->_result.end(), j->_result.begin(), j->_result.end());
+        }
+
+        if (c->_parser && c->HasResult())
+        {
+            const intptr_t parsedEntries = c->_parser->Parse(c);
+
+            c->Stamp(Cmd::PARSE_DONE);
+
+            if (parsedEntries < 0)
+                c->_status = PARSE_ERROR;
+            else if (parsedEntries == 0)
+                c->_status = PARSE_EMPTY;
+        }
+    }
+
+    complCB(c);
+}
+
+
+/**
+ *  \brief
+ */
+ThreadPool::Lane_t CmdEngine::lane(CmdId_t id)
+{
+    // Database indexing can take long, keep it away from the interactive queries
+    if (id == CREATE_DATABASE || id == UPDATE_SINGLE)
+        return ThreadPool::BACKGROUND;
+
+    // Auto-completion is typed ahead - never let it wait for the searches
+    if (id == AUTOCOMPLETE || id == AUTOCOMPLETE_SYMBOL || id == AUTOCOMPLETE_FILE)
+        return ThreadPool::COMPLETION;
+
+    return ThreadPool::INTERACTIVE;
+}
+
+
+/**
+ *  \brief  Interactive queries of the same kind share a group - the newest one supersedes the rest.
+ *          Speculative commands are kept apart so they don't interfere with the user's own searches.
+ */
+int CmdEngine::group(const Cmd& cmd)
+{
+    if (cmd._speculative)
+        return cSpeculativeGroup;
+
+    switch (cmd._id)
+    {
+        case AUTOCOMPLETE:
+        case AUTOCOMPLETE_SYMBOL:
+        case AUTOCOMPLETE_FILE:
+            return AUTOCOMPLETE;
+
+        case FIND_FILE:
+        case FIND_DEFINITION:
+        case FIND_REFERENCE:
+        case FIND_SYMBOL:
+        case GREP:
+        case GREP_TEXT:
+            return cmd._id;
+
+        default:
+            return -1;
+    }
+}
+
+
+/**
+ *  \brief  Attaches the command to a running identical one that is not outdated. Re-run commands
+ *          can be attached only to commands of their own generation. The attached command takes
+ *          the group and generation of the running one as it never goes through supersede().
+ */
+bool CmdEngine::attach(const CmdPtr_t& cmd, CompletionCB complCB)
+{
+    const int grp = (cmd->_generation == 0) ? group(*cmd) : cmd->_group;
+
+    if (grp < 0)
+        return false;
+
+    AUTOLOCK(RunningLock);
+
+    const unsigned latest = Generations[grp];
+
+    for (CmdEngine* engine : Running)
+    {
+        const Cmd& running = *engine->_cmd;
+
+        if (running._group == grp && running._generation == latest &&
+                (cmd->_generation == 0 || cmd->_generation == latest) &&
+                !engine->isSuperseded() && isSame(running, *cmd))
+        {
+            cmd->_group = running._group;
+            cmd->_generation = running._generation;
+
+            engine->_attached.push_back(Attached{cmd, complCB});
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ *  \brief  Checks if the commands would produce the same result
+ */
+bool CmdEngine::isSame(const Cmd& cmd1, const Cmd& cmd2)
+{
+    if (cmd1._id != cmd2._id || cmd1._db != cmd2._db || !(cmd1._tag == cmd2._tag) ||
+            cmd1._ignoreCase != cmd2._ignoreCase || cmd1._regExp != cmd2._regExp ||
+            cmd1._skipLibs != cmd2._skipLibs || cmd1._maxHits != cmd2._maxHits ||
+            cmd1._deadline != cmd2._deadline || cmd1._speculative != cmd2._speculative)
+        return false;
+
+    if (!cmd1._parser || !cmd2._parser)
+        return (!cmd1._parser && !cmd2._parser);
+
+    return (typeid(*cmd1._parser) == typeid(*cmd2._parser));
+}
+
+
+/**
+ *  \brief  Assigns generation to a new command and makes the older running commands of its group
+ *          terminate. Commands re-run (with changed Id) keep their generation and group.
+ *          Returns false if the command itself is already outdated.
+ */
+bool CmdEngine::supersede()
+{
+    if (_cmd->_generation == 0)
+        _cmd->_group = group(*_cmd);
+
+    if (_cmd->_group < 0)
+        return true;
+
+    _hSupersede = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!_hSupersede)
+        return true;
+
+    AUTOLOCK(RunningLock);
+
+    unsigned& latest = Generations[_cmd->_group];
+
+    if (_cmd->_generation == 0)
+        _cmd->_generation = ++latest;
+    else if (_cmd->_generation != latest)
+        return false;
+
+    for (CmdEngine* engine : Running)
+        if (engine->_cmd->_group == _cmd->_group && engine->_cmd->_generation != _cmd->_generation)
+            SetEvent(engine->_hSupersede);
+
+    Running.push_back(this);
+
+    return true;
+}
+
+
+/**
+ *  \brief
+ */
+bool CmdEngine::isSuperseded() const
+{
+    return (_hSupersede && WaitForSingleObject(_hSupersede, 0) == WAIT_OBJECT_0);
+}
+
+
+/**
+ *  \brief
+ */
+bool CmdEngine::isStopped()
+{
+    return (StopEvent && WaitForSingleObject(StopEvent, 0) == WAIT_OBJECT_0);
 }
 
 
@@ -116,20 +694,98 @@ unsigned __stdcall CmdEngine::threadFunc(void* data)
  */
 unsigned CmdEngine::start()
 {
+    if (isStopped())
+    {
+        _cmd->_status = CANCELLED;
+        return 1;
+    }
+
+    // Superseded while waiting to be run
+    if (isSuperseded())
+    {
+        _cmd->_status = SUPERSEDED;
+        return 1;
+    }
+
     ReadPipe dataPipe;
     ReadPipe errorPipe;
 
+    _recording = CmdTrace::Get().IsRecording();
+    _cmd->_partial = false;
+
+    const bool streaming = (_cmd->_parser && _cmd->_parser->IsStreaming());
+    if (streaming)
+    {
+        _cmd->_streamedLen = 0;
+        _cmd->_truncated = false;
+        _cmd->_parser->Begin(_cmd);
+        dataPipe.SetLineCallback(lineCB, this);
+
+        // Searches that can have lots of results are shown progressively while running
+        _progressive = !_cmd->_speculative && (_cmd->_id == FIND_REFERENCE || _cmd->_id == FIND_SYMBOL ||
+                _cmd->_id == GREP || _cmd->_id == GREP_TEXT);
+    }
+
+    // Time limit used up while waiting to be run - complete with no results
+    if (timeLeft() == 0)
+    {
+        _cmd->_partial = true;
+
+        std::vector<char> output;
+        std::vector<char> errOutput;
+
+        return complete(streaming, output, errOutput);
+    }
+
     PROCESS_INFORMATION pi;
 
     if (!runProcess(pi, dataPipe, errorPipe))
         return 1;
 
+    _hProcess = pi.hProcess;
+
+    // Process output is read while waiting so the pipes never fill up and block the process
+    ReadPipe* const pipes[] = {&dataPipe, &errorPipe};
+
+    HANDLE waitHandles[4] = {pi.hProcess};
+    unsigned handlesCount = 1;
+
+    if (_hSupersede)
+        waitHandles[handlesCount++] = _hSupersede;
+
+    if (StopEvent)
+        waitHandles[handlesCount++] = StopEvent;
+
     bool showActivityWin = true;
     if (_cmd->_id != CREATE_DATABASE && _cmd->_id != UPDATE_SINGLE)
     {
+        DWORD waitTime = timeLeft();
+        if (waitTime > 300)
+            waitTime = 300;
+
         // Wait 300 ms and if process has finished don't show Activity Window
-        if (WaitForSingleObject(pi.hProcess, 300) == WAIT_OBJECT_0)
+        const DWORD r = drain(pipes, waitHandles, handlesCount, waitTime);
+        const DWORD handleId = r - WAIT_OBJECT_0;
+
+        if (handleId == 0)
+        {
+            showActivityWin = false;
+        }
+        else if (handleId < handlesCount && waitHandles[handleId] == _hSupersede)
+        {
+            _cmd->_status = SUPERSEDED;
             showActivityWin = false;
+        }
+        else if (handleId < handlesCount && waitHandles[handleId] == StopEvent)
+        {
+            _cmd->_status = CANCELLED;
+            showActivityWin = false;
+        }
+        else if (r == WAIT_TIMEOUT && timeLeft() == 0)
+        {
+            _cmd->_partial = true;
+            showActivityWin = false;
+        }
     }
 
     if (showActivityWin)
@@ -140,7 +796,8 @@ unsigned CmdEngine::start()
         {
             CText header(_cmd->Name());
 
-            if (_cmd->_id != VERSION && _cmd->_id != CTAGS_VERSION)
+            // Batch query tag is a long regexp of all the tags, not useful to show
+            if (_cmd->_id != VERSION && _cmd->_id != CTAGS_VERSION && _cmd->_id != BATCH_DEFINITION)
             {
                 header += _T(" - \"");
                 if (_cmd->_id == CREATE_DATABASE)
@@ -153,10 +810,21 @@ unsigned CmdEngine::start()
             SendMessage(MainWndH, WM_OPEN_ACTIVITY_WIN,
                     reinterpret_cast<WPARAM>(header.C_str()), reinterpret_cast<LPARAM>(hCancel));
 
-            HANDLE waitHandles[] = {pi.hProcess, hCancel};
-            DWORD handleId = WaitForMultipleObjects(2, waitHandles, FALSE, INFINITE) - WAIT_OBJECT_0;
-            if (handleId > 0 && handleId < 2 && waitHandles[handleId] == hCancel)
-                _cmd->_status = CANCELLED;
+            waitHandles[handlesCount++] = hCancel;
+
+            const DWORD r = drain(pipes, waitHandles, handlesCount, timeLeft());
+            const DWORD handleId = r - WAIT_OBJECT_0;
+            if (handleId > 0 && handleId < handlesCount)
+            {
+                if (waitHandles[handleId] == hCancel || waitHandles[handleId] == StopEvent)
+                    _cmd->_status = CANCELLED;
+                else if (waitHandles[handleId] == _hSupersede)
+                    _cmd->_status = SUPERSEDED;
+            }
+            else if (r == WAIT_TIMEOUT)
+            {
+                _cmd->_partial = true;
+            }
 
             SendMessage(MainWndH, WM_CLOSE_ACTIVITY_WIN, 0, reinterpret_cast<LPARAM>(hCancel));
 
@@ -164,39 +832,91 @@ unsigned CmdEngine::start()
         }
         else
         {
-            WaitForSingleObject(pi.hProcess, INFINITE);
+            const DWORD r = drain(pipes, waitHandles, handlesCount, timeLeft());
+            const DWORD handleId = r - WAIT_OBJECT_0;
+            if (handleId > 0 && handleId < handlesCount && waitHandles[handleId] == _hSupersede)
+                _cmd->_status = SUPERSEDED;
+            else if (handleId > 0 && handleId < handlesCount && waitHandles[handleId] == StopEvent)
+                _cmd->_status = CANCELLED;
+            else if (r == WAIT_TIMEOUT)
+                _cmd->_partial = true;
         }
     }
 
     endProcess(pi);
 
-    if (_cmd->_status == CANCELLED)
+    if (_cmd->_status == CANCELLED || _cmd->_status == SUPERSEDED)
         return 1;
 
-    if (!dataPipe.GetOutput().empty())
+    // Drop the results if a newer command of the same kind has been started meanwhile
+    if (isSuperseded())
+    {
+        _cmd->_status = SUPERSEDED;
+        return 1;
+    }
+
+    std::vector<char>& output = dataPipe.GetOutput(cOutputDrainTime);
+
+    // Deadline passed - keep the complete lines read so far
+    if (_cmd->_partial && !streaming && !output.empty())
+    {
+        std::vector<char>::reverse_iterator eol = std::find(output.rbegin(), output.rend(), '\n');
+
+        output.resize(output.rend() - eol);
+        if (!output.empty())
+            output.push_back(0);
+    }
+
+    _cmd->Stamp(Cmd::FIRST_BYTE, dataPipe.FirstByteTime());
+    _cmd->Stamp(Cmd::END_OF_OUTPUT, dataPipe.EndTime());
+    _cmd->_outputBytes = dataPipe.BytesReceived();
+
+    if (_recording)
+        CmdTrace::Get().Write(_cmd, streaming ? _traceOut : output, errorPipe.GetOutput(cOutputDrainTime));
+
+    return complete(streaming, output, errorPipe.GetOutput(cOutputDrainTime));
+}
+
+
+/**
+ *  \brief  Makes the command result out of the process output and parses it. Output buffers are
+ *          zero terminated if not empty. Streamed output has been parsed already line by line.
+ */
+unsigned CmdEngine::complete(bool streaming, std::vector<char>& output, std::vector<char>& errOutput)
+{
+    if (streaming)
+        _cmd->_outputLines = _lines;
+    else if (!output.empty())
+        _cmd->_outputLines = std::count(output.begin(), output.end(), '\n');
+
+    // The pipe buffers are moved to the command result - the output is never copied
+    if (!output.empty())
     {
-        _cmd->AppendToResult(dataPipe.GetOutput());
+        _cmd->AppendToResult(std::move(output));
     }
-    else if (!errorPipe.GetOutput().empty())
+    else if (!_cmd->HasResult() && !errOutput.empty())
     {
         if (_cmd->_id != CREATE_DATABASE && _cmd->_id != UPDATE_SINGLE)
         {
-            _cmd->SetResult(errorPipe.GetOutput());
+            _cmd->SetResult(std::move(errOutput));
             _cmd->_status = FAILED;
             return 1;
         }
 
         if (_cmd->_id == CREATE_DATABASE)
-            _cmd->SetResult(errorPipe.GetOutput());
+            _cmd->SetResult(std::move(errOutput));
     }
 
     _cmd->_status = OK;
 
     if (_cmd->_parser)
     {
-        if (_cmd->Result())
+        if (_cmd->HasResult())
         {
-            const intptr_t parsedEntries = _cmd->_parser->Parse(_cmd);
+            const intptr_t parsedEntries = streaming ?
+                    (_parseError ? -1 : _cmd->_parser->End(_cmd)) : _cmd->_parser->Parse(_cmd);
+
+            _cmd->Stamp(Cmd::PARSE_DONE);
 
             if (parsedEntries < 0)
             {
@@ -209,8 +929,8 @@ unsigned CmdEngine::start()
                 return 1;
             }
         }
-        // Blink the auto-complete word to inform the user if nothing is found
-        else if (_cmd->_id == AUTOCOMPLETE || _cmd->_id == AUTOCOMPLETE_FILE || _cmd->_id == AUTOCOMPLETE_SYMBOL)
+        // Blink the auto-complete word to inform the user if nothing is found (not on trace replay)
+        else if (_complCB && (_cmd->_id == AUTOCOMPLETE || _cmd->_id == AUTOCOMPLETE_FILE || _cmd->_id == AUTOCOMPLETE_SYMBOL))
         {
             CTextA wordA;
             INpp::Get().GetWord(wordA, true, true);
@@ -240,6 +960,69 @@ unsigned CmdEngine::start()
 }
 
 
+/**
+ *  \brief  Returns the time left in ms till the command deadline. The time is counted from Run() so
+ *          the time spent waiting in the queue is included.
+ */
+DWORD CmdEngine::timeLeft() const
+{
+    if (_cmd->_deadline == INFINITE)
+        return INFINITE;
+
+    const DWORD elapsed = GetTickCount() - _runTime;
+
+    return (elapsed < _cmd->_deadline) ? _cmd->_deadline - elapsed : 0;
+}
+
+
+/**
+ *  \brief  Reads the process output until some of the handles gets signaled or the time expires.
+ *          Meanwhile notifies periodically about the parsing progress if needed.
+ */
+DWORD CmdEngine::drain(ReadPipe* const pipes[], const HANDLE* handles, unsigned handlesCount, DWORD time_ms)
+{
+    if (!_progressive)
+        return ReadPipe::Drain(pipes, 2, handles, handlesCount, time_ms);
+
+    const DWORD startTime = GetTickCount();
+
+    for (;;)
+    {
+        DWORD waitTime = cProgressPeriod;
+        if (time_ms != INFINITE)
+        {
+            const DWORD elapsed = GetTickCount() - startTime;
+            const DWORD remaining = (elapsed < time_ms) ? time_ms - elapsed : 0;
+
+            if (waitTime > remaining)
+                waitTime = remaining;
+        }
+
+        const DWORD r = ReadPipe::Drain(pipes, 2, handles, handlesCount, waitTime);
+
+        notifyProgress();
+
+        if (r != WAIT_TIMEOUT || (time_ms != INFINITE && GetTickCount() - startTime >= time_ms))
+            return r;
+    }
+}
+
+
+/**
+ *  \brief  Lets the UI show the results parsed so far. The command thread waits meanwhile so
+ *          the parser is not modified while being accessed.
+ */
+void CmdEngine::notifyProgress()
+{
+    if (_parseError || _cmd->_streamedLen == _notifiedLen)
+        return;
+
+    _notifiedLen = _cmd->_streamedLen;
+
+    SendMessage(MainWndH, WM_RUN_CMD_PROGRESS, 0, (LPARAM)(&_cmd));
+}
+
+
 /**
  *  \brief
  */
@@ -249,7 +1032,7 @@ void CmdEngine::composeCmd(CText& buf) const
     path.StripFilename();
     path += cBinariesFolder;
 
-    buf.Resize(2048);
+    buf.Resize(2048 + _cmd->Tag().Len());
 
     if (_cmd->_id == CREATE_DATABASE || _cmd->_id == VERSION || _cmd->_id == CTAGS_VERSION)
         _sntprintf_s(buf.C_str(), buf.Size(), _TRUNCATE, CmdLine[_cmd->_id], path.C_str());
@@ -283,13 +1066,18 @@ void CmdEngine::composeCmd(CText& buf) const
 
 
 /**
- *  \brief
+ *  \brief  Builds private environment block for the command process - inherits the current
+ *          environment but with GTAGSDBPATH and GTAGSLIBPATH set for this command only
  */
-void CmdEngine::setEnvironmentVars() const
+void CmdEngine::composeEnvironment(std::vector<TCHAR>& env) const
 {
+    static const TCHAR cDbPathVar[]     = _T("GTAGSDBPATH=");
+    static const TCHAR cLibPathVar[]    = _T("GTAGSLIBPATH=");
+
     CText buf;
 
-    if (!_cmd->_skipLibs && (_cmd->_id == AUTOCOMPLETE || _cmd->_id == FIND_DEFINITION))
+    if (!_cmd->_skipLibs &&
+            (_cmd->_id == AUTOCOMPLETE || _cmd->_id == FIND_DEFINITION || _cmd->_id == BATCH_DEFINITION))
     {
         const DbConfig& cfg = _cmd->Db()->GetConfig();
         if (cfg._useLibDb && cfg._libDbPaths.size())
@@ -308,10 +1096,52 @@ void CmdEngine::setEnvironmentVars() const
         }
     }
 
+    std::vector<CText> vars;
+
+    TCHAR* procEnv = GetEnvironmentStrings();
+    if (procEnv)
+    {
+        for (const TCHAR* var = procEnv; *var; var += _tcslen(var) + 1)
+        {
+            if (!_tcsnicmp(var, cDbPathVar, _countof(cDbPathVar) - 1) ||
+                    !_tcsnicmp(var, cLibPathVar, _countof(cLibPathVar) - 1))
+                continue;
+
+            vars.push_back(CText(var));
+        }
+
+        FreeEnvironmentStrings(procEnv);
+    }
+
     if (_cmd->Db())
-        SetEnvironmentVariable(_T("GTAGSDBPATH"), _cmd->Db()->GetPath().C_str());
+    {
+        vars.push_back(CText(cDbPathVar));
+        vars.back() += _cmd->Db()->GetPath();
+    }
+
+    vars.push_back(CText(cLibPathVar));
+    vars.back() += buf;
+
+    // CreateProcess expects the variables sorted by name, case-insensitive
+    std::sort(vars.begin(), vars.end(),
+        [](const CText& a, const CText& b)
+        {
+            const TCHAR* aEnd = _tcschr(a.C_str() + 1, _T('='));
+            const TCHAR* bEnd = _tcschr(b.C_str() + 1, _T('='));
+            const size_t aLen = aEnd ? aEnd - a.C_str() : a.Len();
+            const size_t bLen = bEnd ? bEnd - b.C_str() : b.Len();
+
+            const int r = _tcsnicmp(a.C_str(), b.C_str(), aLen < bLen ? aLen : bLen);
+
+            return (r < 0 || (r == 0 && aLen < bLen));
+        });
 
-    SetEnvironmentVariable(_T("GTAGSLIBPATH"), buf.C_str());
+    env.clear();
+
+    for (const auto& var : vars)
+        env.insert(env.end(), var.C_str(), var.C_str() + var.Len() + 1);
+
+    env.push_back(0);
 }
 
 
@@ -320,29 +1150,75 @@ void CmdEngine::setEnvironmentVars() const
  */
 bool CmdEngine::runProcess(PROCESS_INFORMATION& pi, ReadPipe& dataPipe, ReadPipe& errorPipe)
 {
-    const DWORD createFlags = NORMAL_PRIORITY_CLASS | CREATE_NO_WINDOW | CREATE_UNICODE_ENVIRONMENT;
+    const bool indexing = (_cmd->_id == CREATE_DATABASE || _cmd->_id == UPDATE_SINGLE);
+    const bool prioritize = GTagsSettings._prioritize;
+
+    DWORD createFlags = CREATE_NO_WINDOW | CREATE_UNICODE_ENVIRONMENT;
+
+    // Indexing gives way to the editor and the search queries
+    if (!prioritize)
+        createFlags |= NORMAL_PRIORITY_CLASS;
+    else if (indexing)
+        createFlags |= BELOW_NORMAL_PRIORITY_CLASS | CREATE_SUSPENDED;
+    else
+        createFlags |= ABOVE_NORMAL_PRIORITY_CLASS;
     const TCHAR* currentDir = (_cmd->_id == VERSION || _cmd->_id == CTAGS_VERSION) ?
             NULL : _cmd->Db()->GetPath().C_str();
 
     CText cmdBuf;
     composeCmd(cmdBuf);
 
-    setEnvironmentVars();
+    std::vector<TCHAR> env;
+    composeEnvironment(env);
+
+    // Processes are started from several threads at once - let each inherit only its own pipe
+    // handles or another command's process would keep them open and its output would never end
+    HANDLE inheritHandles[] = {errorPipe.GetInputHandle(), dataPipe.GetInputHandle()};
 
-    STARTUPINFO si  = {0};
-    si.cb           = sizeof(si);
-    si.dwFlags      = STARTF_USESTDHANDLES;
-    si.hStdError    = errorPipe.GetInputHandle();
-    si.hStdOutput   = dataPipe.GetInputHandle();
+    SIZE_T attrListSize = 0;
+    InitializeProcThreadAttributeList(NULL, 1, 0, &attrListSize);
 
-    if (!CreateProcess(NULL, cmdBuf.C_str(), NULL, NULL, TRUE, createFlags, NULL, currentDir, &si, &pi))
+    std::vector<char> attrListBuf(attrListSize);
+    LPPROC_THREAD_ATTRIBUTE_LIST attrList = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attrListBuf.data());
+
+    if (!InitializeProcThreadAttributeList(attrList, 1, 0, &attrListSize))
     {
         _cmd->_status = RUN_ERROR;
         return false;
     }
 
+    STARTUPINFOEX si            = {0};
+    si.StartupInfo.cb           = sizeof(si);
+    si.StartupInfo.dwFlags      = STARTF_USESTDHANDLES;
+    si.StartupInfo.hStdError    = errorPipe.GetInputHandle();
+    si.StartupInfo.hStdOutput   = dataPipe.GetInputHandle();
+    si.lpAttributeList          = attrList;
+
+    BOOL started = UpdateProcThreadAttribute(attrList, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST,
+            inheritHandles, sizeof(inheritHandles), NULL, NULL);
+
+    if (started)
+        started = CreateProcess(NULL, cmdBuf.C_str(), NULL, NULL, TRUE, createFlags | EXTENDED_STARTUPINFO_PRESENT,
+                env.data(), currentDir, &si.StartupInfo, &pi);
+
+    DeleteProcThreadAttributeList(attrList);
+
+    if (!started)
+    {
+        _cmd->_status = RUN_ERROR;
+        return false;
+    }
+
+    _cmd->Stamp(Cmd::PROCESS_STARTED);
+
     SetThreadPriority(pi.hThread, THREAD_PRIORITY_NORMAL);
 
+    if (prioritize && indexing)
+    {
+        setLowIoPriority(pi.hProcess);
+        ResumeThread(pi.hThread);
+    }
+
     if (!errorPipe.Open() || !dataPipe.Open())
     {
         endProcess(pi);
@@ -354,6 +1230,28 @@ bool CmdEngine::runProcess(PROCESS_INFORMATION& pi, ReadPipe& dataPipe, ReadPipe
 }
 
 
+/**
+ *  \brief  Lowers the process disk I/O priority. There is no documented API for another process
+ *          so the native one is used if available.
+ */
+void CmdEngine::setLowIoPriority(HANDLE hProcess)
+{
+    typedef LONG (WINAPI *NtSetInformationProcess_t)(HANDLE, ULONG, PVOID, ULONG);
+
+    static const ULONG cProcessIoPriority = 33;
+    static const ULONG cIoPriorityVeryLow = 0;
+
+    static NtSetInformationProcess_t setInformationProcess = reinterpret_cast<NtSetInformationProcess_t>(
+            GetProcAddress(GetModuleHandle(_T("ntdll.dll")), "NtSetInformationProcess"));
+
+    if (setInformationProcess)
+    {
+        ULONG ioPriority = cIoPriorityVeryLow;
+        setInformationProcess(hProcess, cProcessIoPriority, &ioPriority, sizeof(ioPriority));
+    }
+}
+
+
 /**
  *  \brief
  */
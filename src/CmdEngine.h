@@ -27,8 +27,13 @@
 
 #include <windows.h>
 #include <tchar.h>
+#include <vector>
+#include <list>
+#include <map>
+#include "AutoLock.h"
 #include "Common.h"
 #include "CmdDefines.h"
+#include "ThreadPool.h"
 
 
 class ReadPipe;
@@ -45,25 +50,126 @@ class CmdEngine
 {
 public:
     static bool Run(const CmdPtr_t& cmd, CompletionCB complCB);
+    static bool RunJoined(const CmdPtr_t& cmd, CmdId_t joinedId, CompletionCB complCB);
+    static size_t MaxHits(CmdId_t id);
+    static DWORD Deadline(CmdId_t id);
+    static bool Cancel(const CmdPtr_t& cmd);
+    static void CancelAll();
+
+    // Called on the UI thread to run the completion callbacks of the finished commands
+    static void DeliverCompletions() { Completions.Deliver(); }
 
 private:
+    friend class CmdTrace;
+
+    /**
+     *  \struct  Join
+     *  \brief  Two commands run at the same time whose outputs are merged and parsed together
+     */
+    struct Join
+    {
+        CmdPtr_t        cmd;
+        CmdPtr_t        joinedCmd;
+        ParserPtr_t     parser;
+        CompletionCB    complCB;
+        unsigned        pending;
+    };
+
+    /**
+     *  \struct  Attached
+     *  \brief  Command identical to the running one that gets its result instead of being run
+     */
+    struct Attached
+    {
+        CmdPtr_t        cmd;
+        CompletionCB    complCB;
+    };
+
+    /**
+     *  \struct  Completion
+     *  \brief
+     */
+    struct Completion
+    {
+        SLIST_ENTRY     entry;
+        CmdPtr_t        cmd;
+        CompletionCB    complCB;
+    };
+
+    /**
+     *  \class  CompletionQueue
+     *  \brief  Lock-free queue of finished commands filled by the command threads and emptied by
+     *          the UI thread. A single message is posted for all completions queued till the UI
+     *          thread gets to them.
+     */
+    class CompletionQueue
+    {
+    public:
+        CompletionQueue() : _posted(0) { InitializeSListHead(&_head); }
+        ~CompletionQueue();
+
+        void Push(const CmdPtr_t& cmd, CompletionCB complCB);
+        void Deliver();
+
+    private:
+        static PSLIST_ENTRY reverse(PSLIST_ENTRY entry);
+        static void release(Completion* completion);
+
+        SLIST_HEADER    _head;
+        volatile LONG   _posted;
+    };
+
     static const TCHAR* CmdLine[];
+    static const DWORD  cProgressPeriod;
+    static const DWORD  cOutputDrainTime;
+    static const int    cSpeculativeGroup;
 
-    static unsigned __stdcall threadFunc(void* data);
+    static void taskFunc(void* data);
+    static void lineCB(void* context, char* line, size_t len);
+    static void joinCB(const CmdPtr_t& cmd);
+    static ThreadPool::Lane_t lane(CmdId_t id);
+    static int group(const Cmd& cmd);
+    static bool attach(const CmdPtr_t& cmd, CompletionCB complCB);
+    static bool isSame(const Cmd& cmd1, const Cmd& cmd2);
+
+    static Mutex                    RunningLock;
+    static std::list<CmdEngine*>    Running;
+    static std::map<int, unsigned>  Generations;
+    static std::list<Join>          Joins;
+    static CompletionQueue          Completions;
+    static HANDLE                   StopEvent;
 
     CmdEngine(const CmdPtr_t& cmd, CompletionCB complCB);
     ~CmdEngine();
     CmdEngine& operator=(const CmdEngine&) = delete;
 
+    bool supersede();
+    bool isSuperseded() const;
+    static bool isStopped();
+    DWORD timeLeft() const;
     unsigned start();
+    unsigned complete(bool streaming, std::vector<char>& output, std::vector<char>& errOutput);
+    DWORD drain(ReadPipe* const pipes[], const HANDLE* handles, unsigned handlesCount, DWORD time_ms);
+    void notifyProgress();
     void composeCmd(CText& buf) const;
-    void setEnvironmentVars() const;
+    void composeEnvironment(std::vector<TCHAR>& env) const;
     bool runProcess(PROCESS_INFORMATION& pi, ReadPipe& dataPipe, ReadPipe& errorPipe);
     void endProcess(PROCESS_INFORMATION& pi);
+    void setLowIoPriority(HANDLE hProcess);
 
     CmdPtr_t            _cmd;
     CompletionCB const  _complCB;
-    HANDLE              _hThread;
+    HANDLE              _hSupersede;
+    HANDLE              _hProcess;
+    const DWORD         _runTime;
+    size_t              _lines;
+    bool                _parseError;
+    bool                _progressive;
+    size_t              _notifiedLen;
+    bool                _recording;
+    std::vector<char>   _traceOut;
+
+    std::vector<Attached>   _attached;
 };
 
 } // namespace GTags
@@ -0,0 +1,471 @@
+/**
+ *  \file
+ *  \brief  Commands record and replay
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2022 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <cstring>
+#include <list>
+#include "CmdTrace.h"
+#include "CmdEngine.h"
+#include "DbManager.h"
+#include "LineParser.h"
+#include "BatchParser.h"
+#include "ResultWin.h"
+
+
+namespace GTags
+{
+
+const char CmdTrace::cMagic[8] = {'G', 'T', 'T', 'R', 'A', 'C', 'E', '1'};
+
+
+/**
+ *  \brief  Traces of several sessions are appended to the same file
+ */
+bool CmdTrace::Start(const CPath& traceFile)
+{
+    AUTOLOCK(_lock);
+
+    if (_fp)
+        fclose(_fp);
+
+    _tfopen_s(&_fp, traceFile.C_str(), _T("ab"));
+    if (_fp == NULL)
+        return false;
+
+    fseek(_fp, 0, SEEK_END);
+
+    if (ftell(_fp) == 0 && fwrite(cMagic, sizeof(cMagic), 1, _fp) != 1)
+    {
+        fclose(_fp);
+        _fp = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ *  \brief
+ */
+void CmdTrace::Stop()
+{
+    AUTOLOCK(_lock);
+
+    if (_fp)
+    {
+        fclose(_fp);
+        _fp = NULL;
+    }
+}
+
+
+/**
+ *  \brief  Called from the command threads once the process has finished. The output buffers are
+ *          written without their zero termination. Recording stops on write error.
+ */
+void CmdTrace::Write(const CmdPtr_t& cmd, const std::vector<char>& output, const std::vector<char>& errOutput)
+{
+    const size_t outputLen = (!output.empty() && output.back() == 0) ? output.size() - 1 : output.size();
+    const size_t errOutputLen = (!errOutput.empty() && errOutput.back() == 0) ? errOutput.size() - 1 :
+            errOutput.size();
+
+    uint32_t flags = 0;
+    if (cmd->_ignoreCase)
+        flags |= IGNORE_CASE;
+    if (cmd->_regExp)
+        flags |= REG_EXP;
+    if (cmd->_skipLibs)
+        flags |= SKIP_LIBS;
+    if (cmd->_truncated)
+        flags |= TRUNCATED;
+    if (cmd->_partial)
+        flags |= PARTIAL;
+
+    CPath dbPath;
+    DbConfig dbCfg;
+
+    if (cmd->_db)
+    {
+        dbPath = cmd->_db->GetPath();
+        dbCfg = cmd->_db->GetConfig();
+    }
+
+    if (dbCfg._useLibDb)
+        flags |= USE_LIB_DB;
+    if (dbCfg._usePathFilter)
+        flags |= USE_PATH_FILTER;
+
+    CText libDbPaths;
+    dbCfg.DbPathsToBuf(libDbPaths, _T(';'));
+
+    CText pathFilters;
+    dbCfg.FiltersToBuf(pathFilters, _T(';'));
+
+    const uint32_t id = cmd->_id;
+    const uint64_t maxHits = cmd->_maxHits;
+    const int32_t parserIdx = dbCfg._parserIdx;
+
+    uint64_t stageUs[Cmd::STAGES_COUNT];
+    for (int i = 0; i < Cmd::STAGES_COUNT; ++i)
+        stageUs[i] = cmd->ElapsedUs(Cmd::CREATED, static_cast<Cmd::Stage_t>(i));
+
+    AUTOLOCK(_lock);
+
+    if (_fp == NULL)
+        return;
+
+    bool success = false;
+    if (fwrite(&id, sizeof(id), 1, _fp) == 1)
+    if (fwrite(&flags, sizeof(flags), 1, _fp) == 1)
+    if (fwrite(&maxHits, sizeof(maxHits), 1, _fp) == 1)
+    if (fwrite(stageUs, sizeof(stageUs), 1, _fp) == 1)
+    if (writeStr(_fp, cmd->_tag))
+    if (writeStr(_fp, dbPath))
+    if (fwrite(&parserIdx, sizeof(parserIdx), 1, _fp) == 1)
+    if (writeStr(_fp, libDbPaths))
+    if (writeStr(_fp, pathFilters))
+    if (writeData(_fp, output.data(), outputLen))
+    if (writeData(_fp, errOutput.data(), errOutputLen))
+        success = true;
+
+    if (success)
+    {
+        fflush(_fp);
+    }
+    else
+    {
+        fclose(_fp);
+        _fp = NULL;
+    }
+}
+
+
+/**
+ *  \brief  Feeds the recorded outputs through the same parsing and result making as the command engine
+ *          and calls complCB (if given) for each replayed command. Database indexing is skipped as there
+ *          is nothing to do on the plugin side. Stops early if the plugin is being unloaded. Returns the number
+ *          of replayed commands or -1 if the file is not a trace or is corrupted.
+ */
+intptr_t CmdTrace::Replay(const CPath& traceFile, CompletionCB complCB)
+{
+    FILE* fp;
+    _tfopen_s(&fp, traceFile.C_str(), _T("rb"));
+    if (fp == NULL)
+        return -1;
+
+    char magic[sizeof(cMagic)];
+    if (fread(magic, sizeof(magic), 1, fp) != 1 || memcmp(magic, cMagic, sizeof(magic)))
+    {
+        fclose(fp);
+        return -1;
+    }
+
+    // The same database object is used for the same database as when recorded
+    std::list<DbHandle> dbs;
+
+    intptr_t replayed = 0;
+    Record rec;
+
+    while (!CmdEngine::isStopped() && bytesLeft(fp))
+    {
+        // Corrupted or truncated record - the trace cannot be trusted
+        if (!read(fp, rec))
+        {
+            replayed = -1;
+            break;
+        }
+
+        if (rec.id == CREATE_DATABASE || rec.id == UPDATE_SINGLE)
+            continue;
+
+        DbHandle db;
+
+        if (!rec.dbPath.IsEmpty())
+        {
+            for (std::list<DbHandle>::iterator dbi = dbs.begin(); dbi != dbs.end(); ++dbi)
+            {
+                if ((*dbi)->GetPath() == rec.dbPath && (*dbi)->GetConfig() == rec.dbCfg)
+                {
+                    db = *dbi;
+                    break;
+                }
+            }
+
+            if (!db)
+            {
+                db.reset(new GTagsDb(rec.dbPath, rec.dbCfg));
+                dbs.push_back(db);
+            }
+        }
+
+        CmdPtr_t cmd(new Cmd(rec.id, db, newParser(rec.id), rec.tag.C_str(),
+                (rec.flags & IGNORE_CASE) != 0, (rec.flags & REG_EXP) != 0));
+        cmd->_skipLibs = ((rec.flags & SKIP_LIBS) != 0);
+        cmd->_maxHits = (size_t)rec.maxHits;
+
+        replay(cmd, rec);
+
+        if (complCB)
+            complCB(cmd);
+
+        ++replayed;
+    }
+
+    fclose(fp);
+
+    return replayed;
+}
+
+
+/**
+ *  \brief  Reads the next record. The output buffers are zero terminated if not empty - as the ones
+ *          coming from the process pipes.
+ */
+bool CmdTrace::read(FILE* fp, Record& rec)
+{
+    uint32_t id;
+    int32_t parserIdx;
+    CText libDbPaths;
+    CText pathFilters;
+
+    bool success = false;
+    if (fread(&id, sizeof(id), 1, fp) == 1)
+    if (fread(&rec.flags, sizeof(rec.flags), 1, fp) == 1)
+    if (fread(&rec.maxHits, sizeof(rec.maxHits), 1, fp) == 1)
+    if (fread(rec.stageUs, sizeof(rec.stageUs), 1, fp) == 1)
+    if (readStr(fp, rec.tag))
+    if (readStr(fp, rec.dbPath))
+    if (fread(&parserIdx, sizeof(parserIdx), 1, fp) == 1)
+    if (readStr(fp, libDbPaths))
+    if (readStr(fp, pathFilters))
+    if (readData(fp, rec.output))
+    if (readData(fp, rec.errOutput))
+        success = true;
+
+    if (!success || id > CTAGS_VERSION || parserIdx < 0 || parserIdx >= DbConfig::PARSER_LIST_END)
+        return false;
+
+    rec.id = static_cast<CmdId_t>(id);
+
+    rec.dbCfg.SetDefaults();
+    rec.dbCfg._parserIdx = parserIdx;
+    rec.dbCfg._useLibDb = ((rec.flags & USE_LIB_DB) != 0);
+    rec.dbCfg._usePathFilter = ((rec.flags & USE_PATH_FILTER) != 0);
+    rec.dbCfg.FiltersFromBuf(pathFilters.C_str(), _T(";"));
+
+    // Library databases might not exist where replayed, take the paths as they are
+    TCHAR* pTmp = NULL;
+    for (TCHAR* ptr = _tcstok_s(libDbPaths.C_str(), _T(";"), &pTmp); ptr; ptr = _tcstok_s(NULL, _T(";"), &pTmp))
+        rec.dbCfg._libDbPaths.push_back(CPath(ptr));
+
+    if (!rec.output.empty())
+        rec.output.push_back(0);
+    if (!rec.errOutput.empty())
+        rec.errOutput.push_back(0);
+
+    return true;
+}
+
+
+/**
+ *  \brief  The recorded process stage times are kept - placed right before the replay start. The recorded
+ *          output holds only the accepted lines, the status flags are set after these are fed as the
+ *          command engine would have set them.
+ */
+void CmdTrace::replay(const CmdPtr_t& cmd, Record& rec)
+{
+    const LONGLONG created = Cmd::Now() - Cmd::FromUs(rec.stageUs[Cmd::END_OF_OUTPUT]);
+
+    for (int i = Cmd::CREATED; i <= Cmd::END_OF_OUTPUT; ++i)
+        cmd->_stamps[i] = (i == Cmd::CREATED || rec.stageUs[i]) ? created + Cmd::FromUs(rec.stageUs[i]) : 0;
+
+    cmd->_outputBytes = rec.output.empty() ? 0 : rec.output.size() - 1;
+    cmd->_status = RUN_ERROR;
+
+    // Not run - only completed
+    CmdEngine engine(cmd, NULL);
+
+    const bool streaming = (cmd->_parser && cmd->_parser->IsStreaming());
+    if (streaming)
+    {
+        cmd->_parser->Begin(cmd);
+
+        if (!rec.output.empty())
+        {
+            char* pLine = rec.output.data();
+            char* const pEnd = pLine + rec.output.size() - 1;
+
+            while (pLine < pEnd)
+            {
+                char* pEol = static_cast<char*>(memchr(pLine, '\n', pEnd - pLine));
+                if (pEol == NULL)
+                    pEol = pEnd;
+
+                char* pLineEnd = pEol;
+                if (pLineEnd > pLine && *(pLineEnd - 1) == '\r')
+                    --pLineEnd;
+
+                *pLineEnd = 0;
+                CmdEngine::lineCB(&engine, pLine, pLineEnd - pLine);
+
+                pLine = pEol + 1;
+            }
+
+            rec.output.clear();
+        }
+    }
+
+    cmd->_truncated = ((rec.flags & TRUNCATED) != 0);
+    cmd->_partial = ((rec.flags & PARTIAL) != 0);
+
+    engine.complete(streaming, rec.output, rec.errOutput);
+}
+
+
+/**
+ *  \brief  The same parsers as the ones used for the real commands
+ */
+ParserPtr_t CmdTrace::newParser(CmdId_t id)
+{
+    switch (id)
+    {
+        case AUTOCOMPLETE:
+        case AUTOCOMPLETE_SYMBOL:
+        case AUTOCOMPLETE_FILE:
+            return ParserPtr_t(new LineParser);
+
+        case FIND_FILE:
+        case FIND_DEFINITION:
+        case FIND_REFERENCE:
+        case FIND_SYMBOL:
+        case GREP:
+        case GREP_TEXT:
+            return ParserPtr_t(new ResultWin::TabParser);
+
+        case BATCH_DEFINITION:
+            return ParserPtr_t(new BatchParser);
+
+        default:
+            return ParserPtr_t(NULL);
+    }
+}
+
+
+/**
+ *  \brief
+ */
+bool CmdTrace::writeData(FILE* fp, const char* data, size_t len)
+{
+    const uint64_t len64 = len;
+
+    if (fwrite(&len64, sizeof(len64), 1, fp) != 1)
+        return false;
+
+    return (len == 0 || fwrite(data, len, 1, fp) == 1);
+}
+
+
+/**
+ *  \brief
+ */
+bool CmdTrace::readData(FILE* fp, std::vector<char>& data)
+{
+    uint64_t len64;
+
+    // Corrupted or truncated trace - don't let a bogus length exhaust the memory
+    if (fread(&len64, sizeof(len64), 1, fp) != 1 || len64 > SIZE_MAX - 1 || len64 > bytesLeft(fp))
+        return false;
+
+    data.resize((size_t)len64);
+
+    return (len64 == 0 || fread(data.data(), data.size(), 1, fp) == 1);
+}
+
+
+/**
+ *  \brief  Returns the number of bytes from the current position to the end of the file
+ */
+uint64_t CmdTrace::bytesLeft(FILE* fp)
+{
+    const int64_t pos = _ftelli64(fp);
+    if (pos < 0 || _fseeki64(fp, 0, SEEK_END))
+        return 0;
+
+    const int64_t size = _ftelli64(fp);
+    if (_fseeki64(fp, pos, SEEK_SET) || size < pos)
+        return 0;
+
+    return (uint64_t)(size - pos);
+}
+
+
+/**
+ *  \brief  Strings are stored UTF-8 encoded
+ */
+bool CmdTrace::writeStr(FILE* fp, const CText& str)
+{
+    std::vector<char> utf8;
+
+    if (str.Len())
+    {
+        const int len = WideCharToMultiByte(CP_UTF8, 0, str.C_str(), (int)str.Len(), NULL, 0, NULL, NULL);
+        if (len <= 0)
+            return false;
+
+        utf8.resize(len);
+        WideCharToMultiByte(CP_UTF8, 0, str.C_str(), (int)str.Len(), utf8.data(), len, NULL, NULL);
+    }
+
+    return writeData(fp, utf8.data(), utf8.size());
+}
+
+
+/**
+ *  \brief
+ */
+bool CmdTrace::readStr(FILE* fp, CText& str)
+{
+    std::vector<char> utf8;
+
+    if (!readData(fp, utf8))
+        return false;
+
+    str.Clear();
+
+    if (utf8.empty())
+        return true;
+
+    const int len = MultiByteToWideChar(CP_UTF8, 0, utf8.data(), (int)utf8.size(), NULL, 0);
+    if (len <= 0)
+        return false;
+
+    str.Resize(len);
+    MultiByteToWideChar(CP_UTF8, 0, utf8.data(), (int)utf8.size(), str.C_str(), len);
+    str.AutoFit();
+
+    return true;
+}
+
+} // namespace GTags
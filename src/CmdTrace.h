@@ -0,0 +1,113 @@
+/**
+ *  \file
+ *  \brief  Commands record and replay
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2022 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "AutoLock.h"
+#include "Common.h"
+#include "CmdDefines.h"
+#include "Config.h"
+#include "Cmd.h"
+
+
+namespace GTags
+{
+
+/**
+ *  \class  CmdTrace
+ *  \brief  Records the commands together with their exact process output and stage times so
+ *          the plugin side processing can later be replayed without running GTags
+ */
+class CmdTrace
+{
+public:
+    static CmdTrace& Get()
+    {
+        static CmdTrace Instance;
+        return Instance;
+    }
+
+    bool Start(const CPath& traceFile);
+    void Stop();
+
+    inline bool IsRecording() const { return (_fp != NULL); }
+
+    void Write(const CmdPtr_t& cmd, const std::vector<char>& output, const std::vector<char>& errOutput);
+
+    static intptr_t Replay(const CPath& traceFile, CompletionCB complCB);
+
+private:
+    static const char cMagic[8];
+
+    enum
+    {
+        IGNORE_CASE     = 1,
+        REG_EXP         = 2,
+        SKIP_LIBS       = 4,
+        USE_LIB_DB      = 8,
+        USE_PATH_FILTER = 16,
+        TRUNCATED       = 32,
+        PARTIAL         = 64
+    };
+
+    struct Record
+    {
+        CmdId_t             id;
+        CText               tag;
+        uint32_t            flags;
+        uint64_t            maxHits;
+        uint64_t            stageUs[Cmd::STAGES_COUNT];
+        CPath               dbPath;
+        DbConfig            dbCfg;
+        std::vector<char>   output;
+        std::vector<char>   errOutput;
+    };
+
+    CmdTrace() : _fp(NULL) {}
+    CmdTrace(const CmdTrace&);
+    ~CmdTrace() { Stop(); }
+    CmdTrace& operator=(const CmdTrace&) = delete;
+
+    static bool read(FILE* fp, Record& rec);
+    static void replay(const CmdPtr_t& cmd, Record& rec);
+    static ParserPtr_t newParser(CmdId_t id);
+
+    static bool writeData(FILE* fp, const char* data, size_t len);
+    static bool readData(FILE* fp, std::vector<char>& data);
+    static uint64_t bytesLeft(FILE* fp);
+    static bool writeStr(FILE* fp, const CText& str);
+    static bool readStr(FILE* fp, CText& str);
+
+    Mutex   _lock;
+    FILE*   _fp;
+};
+
+} // namespace GTags
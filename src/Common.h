@@ -149,6 +149,7 @@ public:
 
     void Clear();
     void Resize(size_t size);
+    inline void ShrinkToFit() { _buf.shrink_to_fit(); }
 
     inline size_t Len() const { return (_invalidStrLen) ? strlen(_buf.data()) : (_buf.size() - 1); }
     inline bool IsEmpty() const { return (Len() == 0); }
@@ -43,6 +43,15 @@ const TCHAR Settings::cUseDefDbKey[]     = _T("UseDefaultDB = ");
 const TCHAR Settings::cDefDbPathKey[]    = _T("DefaultDBPath = ");
 const TCHAR Settings::cREOptionKey[]     = _T("RegExp = ");
 const TCHAR Settings::cICOptionKey[]     = _T("IgnoreCase = ");
+const TCHAR Settings::cPrioritizeKey[]   = _T("PrioritizeQueries = ");
+const TCHAR Settings::cSpeculativeFindKey[] = _T("SpeculativeFind = ");
+const TCHAR Settings::cMaxFileHitsKey[]  = _T("MaxFileHits = ");
+const TCHAR Settings::cMaxFindHitsKey[]  = _T("MaxFindHits = ");
+const TCHAR Settings::cMaxGrepHitsKey[]  = _T("MaxGrepHits = ");
+const TCHAR Settings::cComplDeadlineKey[] = _T("AutoCompleteTimeLimit = ");
+const TCHAR Settings::cFindDeadlineKey[] = _T("FindTimeLimit = ");
+const TCHAR Settings::cGrepDeadlineKey[] = _T("SearchTimeLimit = ");
+const TCHAR Settings::cTraceFileKey[]    = _T("TraceFile = ");
 
 const TCHAR DbConfig::cInfo[] =
         _T("# ") PLUGIN_NAME _T(" database config\n");
@@ -350,6 +359,15 @@ void Settings::SetDefaults()
     _defDbPath.Clear();
     _re = false;
     _ic = false;
+    _prioritize = true;
+    _speculativeFind = false;
+    _maxFileHits = 10000;
+    _maxFindHits = 10000;
+    _maxGrepHits = 10000;
+    _complDeadline = 2000;
+    _findDeadline = 0;
+    _grepDeadline = 0;
+    _traceFile.Clear();
 
     _genericDbCfg.SetDefaults();
 }
@@ -418,6 +436,57 @@ bool Settings::Load()
             else
                 _ic = false;
         }
+        else if (!_tcsncmp(line, cPrioritizeKey, _countof(cPrioritizeKey) - 1))
+        {
+            const unsigned pos = _countof(cPrioritizeKey) - 1;
+            if (!_tcsncmp(&line[pos], _T("yes"), _countof(_T("yes")) - 1))
+                _prioritize = true;
+            else
+                _prioritize = false;
+        }
+        else if (!_tcsncmp(line, cSpeculativeFindKey, _countof(cSpeculativeFindKey) - 1))
+        {
+            const unsigned pos = _countof(cSpeculativeFindKey) - 1;
+            if (!_tcsncmp(&line[pos], _T("yes"), _countof(_T("yes")) - 1))
+                _speculativeFind = true;
+            else
+                _speculativeFind = false;
+        }
+        else if (!_tcsncmp(line, cMaxFileHitsKey, _countof(cMaxFileHitsKey) - 1))
+        {
+            const unsigned pos = _countof(cMaxFileHitsKey) - 1;
+            _maxFileHits = _tcstoul(&line[pos], NULL, 10);
+        }
+        else if (!_tcsncmp(line, cMaxFindHitsKey, _countof(cMaxFindHitsKey) - 1))
+        {
+            const unsigned pos = _countof(cMaxFindHitsKey) - 1;
+            _maxFindHits = _tcstoul(&line[pos], NULL, 10);
+        }
+        else if (!_tcsncmp(line, cMaxGrepHitsKey, _countof(cMaxGrepHitsKey) - 1))
+        {
+            const unsigned pos = _countof(cMaxGrepHitsKey) - 1;
+            _maxGrepHits = _tcstoul(&line[pos], NULL, 10);
+        }
+        else if (!_tcsncmp(line, cComplDeadlineKey, _countof(cComplDeadlineKey) - 1))
+        {
+            const unsigned pos = _countof(cComplDeadlineKey) - 1;
+            _complDeadline = _tcstoul(&line[pos], NULL, 10);
+        }
+        else if (!_tcsncmp(line, cFindDeadlineKey, _countof(cFindDeadlineKey) - 1))
+        {
+            const unsigned pos = _countof(cFindDeadlineKey) - 1;
+            _findDeadline = _tcstoul(&line[pos], NULL, 10);
+        }
+        else if (!_tcsncmp(line, cGrepDeadlineKey, _countof(cGrepDeadlineKey) - 1))
+        {
+            const unsigned pos = _countof(cGrepDeadlineKey) - 1;
+            _grepDeadline = _tcstoul(&line[pos], NULL, 10);
+        }
+        else if (!_tcsncmp(line, cTraceFileKey, _countof(cTraceFileKey) - 1))
+        {
+            const unsigned pos = _countof(cTraceFileKey) - 1;
+            _traceFile = &line[pos];
+        }
         else if (!_genericDbCfg.ReadOption(line))
         {
             success = false;
@@ -451,7 +520,16 @@ bool Settings::Save() const
     if (_ftprintf_s(fp, _T("%s%s\n"), cUseDefDbKey, (_useDefDb ? _T("yes") : _T("no"))) > 0)
     if (_ftprintf_s(fp, _T("%s%s\n"), cDefDbPathKey, _defDbPath.C_str()) > 0)
     if (_ftprintf_s(fp, _T("%s%s\n"), cREOptionKey, (_re ? _T("yes") : _T("no"))) > 0)
-    if (_ftprintf_s(fp, _T("%s%s\n\n"), cICOptionKey, (_ic ? _T("yes") : _T("no"))) > 0)
+    if (_ftprintf_s(fp, _T("%s%s\n"), cICOptionKey, (_ic ? _T("yes") : _T("no"))) > 0)
+    if (_ftprintf_s(fp, _T("%s%s\n"), cPrioritizeKey, (_prioritize ? _T("yes") : _T("no"))) > 0)
+    if (_ftprintf_s(fp, _T("%s%s\n"), cSpeculativeFindKey, (_speculativeFind ? _T("yes") : _T("no"))) > 0)
+    if (_ftprintf_s(fp, _T("%s%u\n"), cMaxFileHitsKey, _maxFileHits) > 0)
+    if (_ftprintf_s(fp, _T("%s%u\n"), cMaxFindHitsKey, _maxFindHits) > 0)
+    if (_ftprintf_s(fp, _T("%s%u\n"), cMaxGrepHitsKey, _maxGrepHits) > 0)
+    if (_ftprintf_s(fp, _T("%s%u\n"), cComplDeadlineKey, _complDeadline) > 0)
+    if (_ftprintf_s(fp, _T("%s%u\n"), cFindDeadlineKey, _findDeadline) > 0)
+    if (_ftprintf_s(fp, _T("%s%u\n"), cGrepDeadlineKey, _grepDeadline) > 0)
+    if (_ftprintf_s(fp, _T("%s%s\n\n"), cTraceFileKey, _traceFile.C_str()) > 0)
     if (_genericDbCfg.Write(fp))
         success = true;
 
@@ -475,6 +553,15 @@ const Settings& Settings::operator=(const Settings& rhs)
         _defDbPath      = rhs._defDbPath;
         _re             = rhs._re;
         _ic             = rhs._ic;
+        _prioritize     = rhs._prioritize;
+        _speculativeFind = rhs._speculativeFind;
+        _maxFileHits    = rhs._maxFileHits;
+        _maxFindHits    = rhs._maxFindHits;
+        _maxGrepHits    = rhs._maxGrepHits;
+        _complDeadline  = rhs._complDeadline;
+        _findDeadline   = rhs._findDeadline;
+        _grepDeadline   = rhs._grepDeadline;
+        _traceFile      = rhs._traceFile;
         _genericDbCfg   = rhs._genericDbCfg;
     }
 
@@ -491,7 +578,11 @@ bool Settings::operator==(const Settings& rhs) const
         return true;
 
     return (_useDefDb == rhs._useDefDb && _defDbPath == rhs._defDbPath &&
-            _re == rhs._re && _ic == rhs._ic && _genericDbCfg == rhs._genericDbCfg);
+            _re == rhs._re && _ic == rhs._ic && _prioritize == rhs._prioritize &&
+            _speculativeFind == rhs._speculativeFind && _maxFileHits == rhs._maxFileHits &&
+            _maxFindHits == rhs._maxFindHits && _maxGrepHits == rhs._maxGrepHits &&
+            _complDeadline == rhs._complDeadline && _findDeadline == rhs._findDeadline &&
+            _grepDeadline == rhs._grepDeadline && _traceFile == rhs._traceFile && _genericDbCfg == rhs._genericDbCfg);
 }
 
 } // namespace GTags
@@ -126,6 +126,25 @@ public:
     bool    _re;
     bool    _ic;
 
+    // Database indexing at low CPU and I/O priority, search queries above normal
+    bool    _prioritize;
+
+    // Run Find Definition together with Find Symbol that is used if no definition is found
+    bool    _speculativeFind;
+
+    // Results limits per command type, 0 means no limit
+    unsigned    _maxFileHits;
+    unsigned    _maxFindHits;
+    unsigned    _maxGrepHits;
+
+    // Time limits in ms per command type, 0 means no limit
+    unsigned    _complDeadline;
+    unsigned    _findDeadline;
+    unsigned    _grepDeadline;
+
+    // If set, all commands with their output are recorded in this file
+    CPath       _traceFile;
+
     DbConfig    _genericDbCfg;
 
     mutable bool _dirty = false;
@@ -137,6 +156,15 @@ private:
     static const TCHAR cDefDbPathKey[];
     static const TCHAR cREOptionKey[];
     static const TCHAR cICOptionKey[];
+    static const TCHAR cPrioritizeKey[];
+    static const TCHAR cSpeculativeFindKey[];
+    static const TCHAR cMaxFileHitsKey[];
+    static const TCHAR cMaxFindHitsKey[];
+    static const TCHAR cMaxGrepHitsKey[];
+    static const TCHAR cComplDeadlineKey[];
+    static const TCHAR cFindDeadlineKey[];
+    static const TCHAR cGrepDeadlineKey[];
+    static const TCHAR cTraceFileKey[];
 };
 
 } // namespace GTags
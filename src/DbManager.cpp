@@ -38,7 +38,7 @@ namespace GTags
 /**
  *  \brief
  */
-GTagsDb::GTagsDb(const CPath& dbPath, bool writeEn) : _path(dbPath), _writeLock(writeEn)
+GTagsDb::GTagsDb(const CPath& dbPath, bool writeEn) : _path(dbPath), _writeLock(writeEn), _generation(0)
 {
     if (!_cfg.LoadFromFolder(dbPath))
         _cfg = GTagsSettings._genericDbCfg;
@@ -47,6 +47,16 @@ GTagsDb::GTagsDb(const CPath& dbPath, bool writeEn) : _path(dbPath), _writeLock(
 }
 
 
+/**
+ *  \brief  Database with known config - nothing is read from the disk or the plugin settings so it
+ *          can be made on any thread. Used for the trace replay.
+ */
+GTagsDb::GTagsDb(const CPath& dbPath, const DbConfig& cfg) :
+    _path(dbPath), _cfg(cfg), _readLocks(1), _writeLock(false), _generation(0)
+{
+}
+
+
 /**
  *  \brief
  */
@@ -146,6 +156,7 @@ void GTagsDb::dbUpdateCB(const CmdPtr_t& cmd)
         MessageBox(INpp::Get().GetHandle(), msg.C_str(), cmd->Name(), MB_OK | MB_ICONEXCLAMATION);
     }
 
+    cmd->Db()->IncGeneration();
     cmd->Db()->unlock();
     cmd->Db()->runScheduledUpdate();
 
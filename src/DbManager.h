@@ -48,7 +48,15 @@ public:
     inline const CPath& GetPath() const { return _path; }
 
     inline const DbConfig& GetConfig() const { return _cfg; }
-    inline void SetConfig(const DbConfig& cfg) { _cfg = cfg; }
+    inline void SetConfig(const DbConfig& cfg)
+    {
+        _cfg = cfg;
+        ++_generation;
+    }
+
+    // Changes each time the database contents or config change
+    inline unsigned Generation() const { return _generation; }
+    inline void IncGeneration() { ++_generation; }
 
     void Update(const CPath& file);
     void ScheduleUpdate(const CPath& file);
@@ -60,8 +68,10 @@ public:
 
 private:
     friend class DbManager;
+    friend class CmdTrace;
 
     GTagsDb(const CPath& dbPath, bool writeEn);
+    GTagsDb(const CPath& dbPath, const DbConfig& cfg);
 
     static void dbUpdateCB(const CmdPtr_t& cmd);
 
@@ -76,6 +86,8 @@ private:
     int     _readLocks;
     bool    _writeLock;
 
+    unsigned    _generation;
+
     std::list<CPath> _updateList;
 };
 
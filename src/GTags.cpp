@@ -25,13 +25,22 @@
 #include <windows.h>
 #include <tchar.h>
 #include <objbase.h>
+#include <cctype>
 #include <memory>
+#include <list>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <unordered_set>
 #include "Common.h"
 #include "INpp.h"
 #include "Config.h"
 #include "DbManager.h"
 #include "Cmd.h"
 #include "CmdEngine.h"
+#include "ThreadPool.h"
+#include "ResultCache.h"
+#include "CmdTrace.h"
 #include "DocLocation.h"
 #include "SearchWin.h"
 #include "ActivityWin.h"
@@ -41,6 +50,7 @@
 #include "AboutWin.h"
 #include "GTags.h"
 #include "LineParser.h"
+#include "BatchParser.h"
 
 
 namespace
@@ -55,10 +65,63 @@ constexpr int MIN_NOTEPADPP_VERSION_MINOR = 410;
 constexpr int MIN_NOTEPADPP_VERSION = ((MIN_NOTEPADPP_VERSION_MAJOR << 16) | MIN_NOTEPADPP_VERSION_MINOR);
 
 
+constexpr int DEFINITION_INDIC = INDIC_CONTAINER + 7;
+
+
 std::unique_ptr<CPath>  ChangedFile;
 bool                    DeInitCOM = false;
 
 
+/**
+ *  \struct  SpeculativeFind
+ *  \brief  Find Definition run together with Find Symbol. The symbol results are used only if
+ *          no definition is found.
+ */
+struct SpeculativeFind
+{
+    CmdPtr_t    defCmd;
+    CmdPtr_t    symCmd;
+    bool        defDone;
+    bool        symDone;
+};
+
+std::list<SpeculativeFind> SpeculativeFinds;
+
+
+/**
+ *  \struct  DefinitionMarks
+ *  \brief  Words on screen looked up by batch queries run one after another. Each query marks
+ *          the words it has found.
+ */
+struct DefinitionMarks
+{
+    CPath               file;
+    std::vector<CText>  tags;
+    size_t              nextTag;    // First tag not queried yet
+    CmdPtr_t            cmd;        // Query in progress
+};
+
+DefinitionMarks Marks;
+
+
+/**
+ *  \struct  ReplayTiming
+ *  \brief  Replayed commands times summed up per command type
+ */
+struct ReplayTiming
+{
+    unsigned    count;
+    uint64_t    runUs;      // GTags run time as recorded
+    uint64_t    parseUs;    // Plugin side processing time in the replay
+    uint64_t    maxParseUs;
+};
+
+ReplayTiming ReplayTimings[CTAGS_VERSION + 1];
+
+bool ReplayRunning = false;
+bool ReplayPausedRecording = false;
+
+
 /**
  *  \brief
  */
@@ -206,12 +269,17 @@ void autoComplCB(const CmdPtr_t& cmd)
 {
     DbManager::Get().PutDb(cmd->Db());
 
-    if (cmd->Status() == OK && cmd->Result())
+    if (cmd->Status() == OK && cmd->HasResult())
     {
         AutoCompleteWin::Show(cmd);
+        cmd->Stamp(Cmd::SHOWN);
         return;
     }
 
+    // Newer auto-completion is already running, leave the selection to it
+    if (cmd->Status() == SUPERSEDED)
+        return;
+
     INpp::Get().ClearSelection();
 
     if (cmd->Status() == FAILED)
@@ -230,51 +298,148 @@ void autoComplCB(const CmdPtr_t& cmd)
 /**
  *  \brief
  */
-void halfComplCB(const CmdPtr_t& cmd)
+void findCB(const CmdPtr_t& cmd)
 {
-    if (cmd->Status() == OK)
+    if (cmd->Status() == OK && !cmd->HasResult())
     {
-        cmd->Id(AUTOCOMPLETE_SYMBOL);
+        cmd->Id(FIND_SYMBOL);
+
+        CmdEngine::Run(cmd, showResultCB);
+    }
+    else
+    {
+        showResultCB(cmd);
+    }
+}
+
+
+/**
+ *  \brief
+ */
+std::list<SpeculativeFind>::iterator getSpeculativeFind(const CmdPtr_t& cmd)
+{
+    std::list<SpeculativeFind>::iterator sf;
+
+    for (sf = SpeculativeFinds.begin(); sf != SpeculativeFinds.end(); ++sf)
+        if (sf->defCmd == cmd || sf->symCmd == cmd)
+            break;
+
+    return sf;
+}
 
-        ParserPtr_t parser(new LineParser);
-        cmd->Parser(parser);
 
-        CmdEngine::Run(cmd, autoComplCB);
+/**
+ *  \brief  Each of the paired commands holds its own database lock until the pair is resolved
+ */
+void speculativeFindCB(const CmdPtr_t& cmd)
+{
+    std::list<SpeculativeFind>::iterator sf = getSpeculativeFind(cmd);
+
+    // Search window cancelled - the command has not been run at all, definition found in cache or
+    // failed to start
+    if (sf == SpeculativeFinds.end())
+    {
+        showResultCB(cmd);
         return;
     }
 
-    DbManager::Get().PutDb(cmd->Db());
+    if (cmd == sf->defCmd)
+        sf->defDone = true;
+    else
+        sf->symDone = true;
 
-    INpp::Get().ClearSelection();
+    if (!sf->defDone)
+        return;
 
-    if (cmd->Status() == FAILED)
+    const bool useSymbol = (sf->defCmd->Status() == OK && !sf->defCmd->HasResult());
+
+    if (cmd == sf->defCmd)
     {
-        CText msg(cmd->Result());
-        msg += _T("\nTry re-creating database.");
-        MessageBox(INpp::Get().GetHandle(), msg.C_str(), cmd->Name(), MB_OK | MB_ICONEXCLAMATION);
+        if (useSymbol)
+            DbManager::Get().PutDb(cmd->Db());
+        else
+            showResultCB(cmd);
+
+        if (!sf->symDone)
+        {
+            // Definition found - don't keep a worker busy with the symbol search
+            if (!useSymbol)
+                CmdEngine::Cancel(sf->symCmd);
+
+            return;
+        }
     }
-    else if (cmd->Status() == RUN_ERROR)
+
+    const CmdPtr_t defCmd = sf->defCmd;
+    const CmdPtr_t symCmd = sf->symCmd;
+
+    SpeculativeFinds.erase(sf);
+
+    if (!useSymbol)
     {
-        MessageBox(INpp::Get().GetHandle(), _T("Running GTags failed"), cmd->Name(), MB_OK | MB_ICONERROR);
+        DbManager::Get().PutDb(symCmd->Db());
+    }
+    else if (symCmd->Status() == OK || symCmd->Status() == PARSE_EMPTY)
+    {
+        showResultCB(symCmd);
+    }
+    else
+    {
+        // Symbol search didn't complete - do it the usual way holding its database lock. The lock is
+        // released by showResultCB() even if the command fails to start.
+        defCmd->Id(FIND_SYMBOL);
+        CmdEngine::Run(defCmd, showResultCB);
     }
 }
 
 
 /**
- *  \brief
+ *  \brief  Starts Find Definition and Find Symbol together so a missing definition doesn't cost
+ *          two searches in a row
  */
-void findCB(const CmdPtr_t& cmd)
+bool runSpeculativeFind(const CmdPtr_t& cmd)
 {
-    if (cmd->Status() == OK && cmd->Result() == NULL)
+    bool success;
+    DbHandle db = DbManager::Get().GetDbAt(cmd->Db()->GetPath(), false, &success);
+
+    if (!success)
     {
-        cmd->Id(FIND_SYMBOL);
+        if (db)
+            DbManager::Get().PutDb(db);
 
-        CmdEngine::Run(cmd, showResultCB);
+        return CmdEngine::Run(cmd, findCB);
     }
-    else
+
+    ParserPtr_t parser(new ResultWin::TabParser);
+    CmdPtr_t symCmd(new Cmd(FIND_SYMBOL, db, parser, cmd->Tag().C_str(), cmd->IgnoreCase(), cmd->RegExp()));
+    symCmd->Speculative(true);
+
+    SpeculativeFinds.push_back(SpeculativeFind{cmd, symCmd, false, false});
+    std::list<SpeculativeFind>::iterator sf = std::prev(SpeculativeFinds.end());
+
+    // Definition search not started - its failure completion is shown on its own, the symbol search
+    // is not needed
+    if (!CmdEngine::Run(cmd, speculativeFindCB))
     {
-        showResultCB(cmd);
+        SpeculativeFinds.erase(sf);
+        DbManager::Get().PutDb(db);
+        return false;
     }
+
+    // Definition found in cache - symbol search is not needed. The cached result is set by Run()
+    // right away while its completion is still delivered later so the command status cannot be used.
+    if (cmd->IsCached())
+    {
+        DbManager::Get().PutDb(db);
+        SpeculativeFinds.erase(sf);
+        return true;
+    }
+
+    // Symbol search that fails to start completes with its failure status as well - the usual Find
+    // Symbol is run then if no definition is found
+    CmdEngine::Run(symCmd, speculativeFindCB);
+
+    return true;
 }
 
 
@@ -283,6 +448,8 @@ void findCB(const CmdPtr_t& cmd)
  */
 void dbWriteCB(const CmdPtr_t& cmd)
 {
+    cmd->Db()->IncGeneration();
+
     if (cmd->Status() != OK)
         DbManager::Get().UnregisterDb(cmd->Db());
     else
@@ -303,6 +470,45 @@ void dbWriteCB(const CmdPtr_t& cmd)
 }
 
 
+/**
+ *  \brief  Appends the worker lanes and the results cache statistics - used to tune their sizes
+ */
+void appendDiagnostics(CText& msg)
+{
+    static const TCHAR* const cLaneNames[ThreadPool::LANES_COUNT] =
+    {
+        _T("Interactive"),
+        _T("Completion"),
+        _T("Background")
+    };
+
+    TCHAR buf[256];
+
+    msg += _T("\nDiagnostics:\n");
+
+    for (int lane = 0; lane < ThreadPool::LANES_COUNT; ++lane)
+    {
+        const ThreadPool::Stats stats = ThreadPool::Get().GetStats(static_cast<ThreadPool::Lane_t>(lane));
+        const double avgWaitMs = stats.completed ? stats.totalWaitUs / 1000.0 / stats.completed : 0.0;
+
+        _sntprintf_s(buf, _countof(buf), _TRUNCATE,
+                _T("\n%s lane: %u workers (%u busy), %u queued (max %u), %llu tasks done,")
+                _T(" wait avg %.1f ms (max %.1f ms)"),
+                cLaneNames[lane], stats.workers, stats.busy, (unsigned)stats.queued, (unsigned)stats.maxQueued,
+                (unsigned long long)stats.completed, avgWaitMs, stats.maxWaitUs / 1000.0);
+        msg += buf;
+    }
+
+    const ResultCache::Stats stats = ResultCache::Get().GetStats();
+
+    _sntprintf_s(buf, _countof(buf), _TRUNCATE,
+            _T("\nResults cache: %u entries (%.1f MB), %llu hits, %llu misses, %llu evictions\n"),
+            (unsigned)stats.entries, stats.size / (1024.0 * 1024.0), (unsigned long long)stats.hits,
+            (unsigned long long)stats.misses, (unsigned long long)stats.evictions);
+    msg += buf;
+}
+
+
 /**
 *  \brief
 */
@@ -314,7 +520,9 @@ void aboutCB(const CmdPtr_t& cmd)
         cmd->AppendToResult(txt.Vector());
     }
 
-	const CText msg = cmd->Result();
+	CText msg = cmd->Result();
+
+	appendDiagnostics(msg);
 
 	AboutWin::Show(msg.C_str());
 }
@@ -339,6 +547,122 @@ void halfAboutCB(const CmdPtr_t& cmd)
 }
 
 
+/**
+ *  \brief  Gets the identifiers shown on screen together with their document positions
+ */
+void getWordsOnScreen(std::vector<std::string>& words, std::vector<intptr_t>& positions)
+{
+    CTextA text;
+    const intptr_t startPos = INpp::Get().GetVisibleText(text);
+
+    const char* pText = text.C_str();
+
+    for (const char* pCh = pText; *pCh;)
+    {
+        if (!isalnum((unsigned char)*pCh) && *pCh != '_')
+        {
+            ++pCh;
+            continue;
+        }
+
+        const char* pWord = pCh;
+        while (isalnum((unsigned char)*pCh) || *pCh == '_')
+            ++pCh;
+
+        if (!isdigit((unsigned char)*pWord))
+        {
+            words.emplace_back(pWord, pCh - pWord);
+            positions.push_back(startPos + (pWord - pText));
+        }
+    }
+}
+
+
+void markDefinitionsCB(const CmdPtr_t& cmd);
+
+
+/**
+ *  \brief  Runs the batch query for the next portion of the tags that fits in it
+ */
+void runMarkQuery(const DbHandle& db)
+{
+    CText query;
+    Marks.nextTag = BatchParser::ComposeQuery(Marks.tags, query, Marks.nextTag);
+
+    ParserPtr_t parser(new BatchParser);
+    Marks.cmd.reset(new Cmd(BATCH_DEFINITION, db, parser, query.C_str(), false, true));
+
+    CmdEngine::Run(Marks.cmd, markDefinitionsCB);
+}
+
+
+/**
+ *  \brief  Marks the words on screen found by the batch query and runs the next one if there are
+ *          tags left. The view is read again as it might have been scrolled or edited meanwhile.
+ *          The database lock is passed on to the next query.
+ */
+void markDefinitionsCB(const CmdPtr_t& cmd)
+{
+    // Marking started anew meanwhile
+    if (cmd != Marks.cmd)
+    {
+        DbManager::Get().PutDb(cmd->Db());
+        return;
+    }
+
+    Marks.cmd.reset();
+
+    if (cmd->Status() != OK)
+    {
+        DbManager::Get().PutDb(cmd->Db());
+
+        if (cmd->Status() == FAILED)
+        {
+            CText msg(cmd->Result());
+            msg += _T("\nTry re-creating database.");
+            MessageBox(INpp::Get().GetHandle(), msg.C_str(), cmd->Name(), MB_OK | MB_ICONEXCLAMATION);
+        }
+        else if (cmd->Status() == RUN_ERROR)
+        {
+            MessageBox(INpp::Get().GetHandle(), _T("Running GTags failed"), cmd->Name(), MB_OK | MB_ICONERROR);
+        }
+
+        return;
+    }
+
+    INpp& npp = INpp::Get();
+
+    CPath currentFile;
+    npp.GetFilePath(currentFile);
+
+    if (!(currentFile == Marks.file))
+    {
+        DbManager::Get().PutDb(cmd->Db());
+        return;
+    }
+
+    const BatchParser* parser = dynamic_cast<const BatchParser*>(cmd->Parser().get());
+
+    if (parser && cmd->HasResult())
+    {
+        std::vector<std::string> words;
+        std::vector<intptr_t> positions;
+        getWordsOnScreen(words, positions);
+
+        npp.SetIndicatorStyle(DEFINITION_INDIC, INDIC_DOTS);
+
+        for (size_t i = 0; i < words.size(); ++i)
+            if (parser->GetResults(words[i]))
+                npp.SetIndicator(DEFINITION_INDIC, positions[i], words[i].size());
+    }
+
+    if (Marks.nextTag < Marks.tags.size())
+        runMarkQuery(cmd->Db());
+    else
+        DbManager::Get().PutDb(cmd->Db());
+}
+
+
 /**
  *  \brief
  */
@@ -352,9 +676,10 @@ void AutoComplete()
     if (!db)
         return;
 
-    CmdPtr_t cmd(new Cmd(AUTOCOMPLETE, db, NULL, tag.C_str(), GTagsSettings._ic));
+    ParserPtr_t parser(new LineParser);
+    CmdPtr_t cmd(new Cmd(AUTOCOMPLETE, db, parser, tag.C_str(), GTagsSettings._ic));
 
-    CmdEngine::Run(cmd, halfComplCB);
+    CmdEngine::RunJoined(cmd, AUTOCOMPLETE_SYMBOL, autoComplCB);
 }
 
 
@@ -446,7 +771,7 @@ void FindDefinition()
     else
     {
         cmd->Tag(tag);
-        CmdEngine::Run(cmd, findCB);
+        RunSearch(cmd, findCB);
     }
 }
 
@@ -563,6 +888,49 @@ void SearchOther()
 }
 
 
+/**
+ *  \brief  Marks the words on screen that have definitions. They are looked up with as few batch
+ *          queries as their length allows.
+ */
+void MarkDefinitions()
+{
+    SearchWin::Close();
+
+    DbHandle db = getDatabase();
+    if (!db)
+        return;
+
+    INpp& npp = INpp::Get();
+
+    // The old marks are cleared right away so none of them is left if the queries fail
+    npp.ClearIndicator(DEFINITION_INDIC);
+
+    std::vector<std::string> words;
+    std::vector<intptr_t> positions;
+    getWordsOnScreen(words, positions);
+
+    std::unordered_set<std::string> unique;
+
+    Marks.tags.clear();
+    Marks.nextTag = 0;
+
+    for (const std::string& word : words)
+        if (unique.insert(word).second)
+            Marks.tags.emplace_back(word.c_str());
+
+    if (Marks.tags.empty())
+    {
+        Marks.cmd.reset();
+        DbManager::Get().PutDb(db);
+        return;
+    }
+
+    npp.GetFilePath(Marks.file);
+
+    runMarkQuery(db);
+}
+
+
 /**
  *  \brief
  */
@@ -712,6 +1080,112 @@ void SettingsCfg()
 }
 
 
+/**
+ *  \brief
+ */
+void replayTimingCB(const CmdPtr_t& cmd)
+{
+    ReplayTiming& timing = ReplayTimings[cmd->Id()];
+    const uint64_t parseUs = cmd->ElapsedUs(Cmd::END_OF_OUTPUT, Cmd::PARSE_DONE);
+
+    ++timing.count;
+    timing.runUs += cmd->ElapsedUs(Cmd::CREATED, Cmd::END_OF_OUTPUT);
+    timing.parseUs += parseUs;
+    if (timing.maxParseUs < parseUs)
+        timing.maxParseUs = parseUs;
+}
+
+
+/**
+ *  \brief  Runs on the pool - replays the trace and posts the processing times per command type
+ *          report to the UI thread
+ */
+void replayTask(void* data)
+{
+    std::unique_ptr<CPath> traceFile(static_cast<CPath*>(data));
+
+    for (ReplayTiming& timing : ReplayTimings)
+        timing = ReplayTiming();
+
+    const LONGLONG start = Cmd::Now();
+    const intptr_t replayed = CmdTrace::Replay(*traceFile, replayTimingCB);
+    const uint64_t totalUs = Cmd::ToUs(Cmd::Now() - start);
+
+    CText* report;
+
+    if (replayed < 0)
+    {
+        report = new CText(_T("Command trace\n\""));
+        *report += *traceFile;
+        *report += _T("\"\ncannot be read.");
+    }
+    else
+    {
+        TCHAR buf[256];
+
+        _sntprintf_s(buf, _countof(buf), _TRUNCATE, _T("%u commands replayed in %.1f ms\n"),
+                (unsigned)replayed, totalUs / 1000.0);
+        report = new CText(buf);
+
+        for (size_t id = 0; id < _countof(ReplayTimings); ++id)
+        {
+            const ReplayTiming& timing = ReplayTimings[id];
+            if (timing.count == 0)
+                continue;
+
+            _sntprintf_s(buf, _countof(buf), _TRUNCATE,
+                    _T("\n%s (%u):\n    GTags run %.1f ms, processing %.1f ms (max %.1f ms)"),
+                    Cmd::CmdName[id], timing.count, timing.runUs / 1000.0, timing.parseUs / 1000.0,
+                    timing.maxParseUs / 1000.0);
+            *report += buf;
+        }
+    }
+
+    if (!PostMessage(MainWndH, WM_REPLAY_DONE, (WPARAM)(replayed < 0), reinterpret_cast<LPARAM>(report)))
+        delete report;
+}
+
+
+/**
+ *  \brief  Replays the configured command trace in the background to profile the plugin side results
+ *          processing without running GTags
+ */
+void ReplayTrace()
+{
+    HWND hOwner = INpp::Get().GetHandle();
+
+    if (ReplayRunning)
+    {
+        MessageBox(hOwner, _T("Command trace replay is already running"), cPluginName, MB_OK | MB_ICONINFORMATION);
+        return;
+    }
+
+    if (GTagsSettings._traceFile.IsEmpty())
+    {
+        MessageBox(hOwner, _T("Command trace file is not configured"), cPluginName, MB_OK | MB_ICONINFORMATION);
+        return;
+    }
+
+    // The trace cannot be read while it is open for recording - recording is resumed when the replay is done
+    ReplayPausedRecording = CmdTrace::Get().IsRecording();
+    if (ReplayPausedRecording)
+        CmdTrace::Get().Stop();
+
+    CPath* traceFile = new CPath(GTagsSettings._traceFile);
+
+    if (!ThreadPool::Get().Enqueue(ThreadPool::BACKGROUND, replayTask, traceFile))
+    {
+        delete traceFile;
+
+        if (ReplayPausedRecording)
+            CmdTrace::Get().Start(GTagsSettings._traceFile);
+        return;
+    }
+
+    ReplayRunning = true;
+}
+
+
 /**
  *  \brief
  */
@@ -727,7 +1201,7 @@ void About()
 namespace GTags
 {
 
-FuncItem Menu[21] = {
+FuncItem Menu[24] = {
     /* 0 */  FuncItem(Cmd::CmdName[AUTOCOMPLETE], AutoComplete),
     /* 1 */  FuncItem(Cmd::CmdName[AUTOCOMPLETE_FILE], AutoCompleteFile),
     /* 2 */  FuncItem(Cmd::CmdName[FIND_FILE], FindFile),
@@ -748,7 +1222,11 @@ FuncItem Menu[21] = {
     /* 17 */ FuncItem(),
     /* 18 */ FuncItem(_T("Settings..."), SettingsCfg),
     /* 19 */ FuncItem(),
-    /* 20 */ FuncItem(_T("About..."), About)
+    /* 20 */ FuncItem(_T("About..."), About),
+    // New commands are added at the end so the shortcuts saved by their index stay valid
+    /* 21 */ FuncItem(),
+    /* 22 */ FuncItem(_T("Mark Definitions On Screen"), MarkDefinitions),
+    /* 23 */ FuncItem(_T("Replay Command Trace"), ReplayTrace)
 };
 
 HINSTANCE HMod = NULL;
@@ -793,6 +1271,19 @@ DbHandle getDatabaseAt(const CPath& dbPath)
 }
 
 
+/**
+ *  \brief  Runs search command. Find Definition is run together with Find Symbol if speculative
+ *          find is enabled.
+ */
+bool RunSearch(const CmdPtr_t& cmd, CompletionCB complCB)
+{
+    if (complCB == findCB && cmd->Id() == FIND_DEFINITION && GTagsSettings._speculativeFind)
+        return runSpeculativeFind(cmd);
+
+    return CmdEngine::Run(cmd, complCB);
+}
+
+
 /**
  *  \brief
  */
@@ -800,17 +1291,22 @@ void showResultCB(const CmdPtr_t& cmd)
 {
     DbManager::Get().PutDb(cmd->Db());
 
+    if (cmd->Status() != OK)
+        ResultWin::Abort(cmd);
+
     if (cmd->Status() == OK || cmd->Status() == PARSE_EMPTY)
     {
-        if (cmd->Result() && cmd->Status() == OK)
+        if (cmd->HasResult() && cmd->Status() == OK)
         {
             ResultWin::Show(cmd);
+            cmd->Stamp(Cmd::SHOWN);
+            ResultCache::Get().Put(cmd);
         }
         else
         {
             CText msg(_T("\""));
             msg += cmd->Tag();
-            msg += _T("\" not found.");
+            msg += cmd->IsPartial() ? _T("\" not found within the time limit.") : _T("\" not found.");
             MessageBox(INpp::Get().GetHandle(), msg.C_str(), cmd->Name(), MB_OK | MB_ICONINFORMATION);
 
             ResultWin::Close(cmd);
@@ -883,6 +1379,9 @@ void PluginInit()
     {
         if (!GTagsSettings.Load())
             GTagsSettings.Save();
+
+        if (!GTagsSettings._traceFile.IsEmpty())
+            CmdTrace::Get().Start(GTagsSettings._traceFile);
     }
 }
 
@@ -895,6 +1394,12 @@ void PluginDeInit()
     if (GTagsSettings._dirty)
         GTagsSettings.Save();
 
+    // The command completions still need the windows - let them all finish first
+    CmdEngine::CancelAll();
+    ThreadPool::Get().Stop();
+    CmdEngine::DeliverCompletions();
+    CmdTrace::Get().Stop();
+
     ActivityWin::Unregister();
     SearchWin::Unregister();
     AutoCompleteWin::Unregister();
@@ -1008,6 +1513,31 @@ void OnFileRename(const CPath& file)
 }
 
 
+/**
+ *  \brief  Shows the command trace replay report and resumes the recording paused for the replay
+ */
+void OnReplayDone(const CText& report, bool failed)
+{
+    ReplayRunning = false;
+
+    if (ReplayPausedRecording && !GTagsSettings._traceFile.IsEmpty())
+        CmdTrace::Get().Start(GTagsSettings._traceFile);
+
+    if (failed)
+    {
+        MessageBox(INpp::Get().GetHandle(), report.C_str(), cPluginName, MB_OK | MB_ICONEXCLAMATION);
+        return;
+    }
+
+    CText msg(report);
+    msg += _T('\n');
+
+    appendDiagnostics(msg);
+
+    MessageBox(INpp::Get().GetHandle(), msg.C_str(), _T("Command Trace Replay"), MB_OK | MB_ICONINFORMATION);
+}
+
+
 /**
  *  \brief
  */
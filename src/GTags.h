@@ -48,11 +48,13 @@ const TCHAR cBinariesFolder[]       = _T("bin");
 enum PluginWinMessages_t
 {
     WM_RUN_CMD_CALLBACK = WM_USER,
+    WM_RUN_CMD_PROGRESS,
     WM_OPEN_ACTIVITY_WIN,
-    WM_CLOSE_ACTIVITY_WIN
+    WM_CLOSE_ACTIVITY_WIN,
+    WM_REPLAY_DONE
 };
 
-extern FuncItem     Menu[21];
+extern FuncItem     Menu[24];
 
 extern HINSTANCE    HMod;
 extern CPath        DllPath;
@@ -68,6 +70,7 @@ extern Settings GTagsSettings;
 
 
 DbHandle getDatabaseAt(const CPath& dbPath);
+bool RunSearch(const CmdPtr_t& cmd, CompletionCB complCB);
 void showResultCB(const CmdPtr_t& cmd);
 
 BOOL PluginLoad(HINSTANCE hMod);
@@ -81,4 +84,6 @@ void OnFileChange(const CPath& file);
 void OnFileRename(const CPath& file);
 void OnFileDelete(const CPath& file);
 
+void OnReplayDone(const CText& report, bool failed);
+
 } // namespace GTags
@@ -75,6 +75,37 @@ void INpp::GetWord(CTextA& word, bool partial, bool select) const
 }
 
 
+/**
+ *  \brief  Gets the text of the document lines shown on screen. Returns its start position.
+ */
+intptr_t INpp::GetVisibleText(CTextA& text) const
+{
+    const intptr_t linesCount       = SendMessage(_hSC, SCI_GETLINECOUNT, 0, 0);
+    const intptr_t linesOnScreen    = SendMessage(_hSC, SCI_LINESONSCREEN, 0, 0);
+    const intptr_t firstVisibleLine = SendMessage(_hSC, SCI_GETFIRSTVISIBLELINE, 0, 0);
+
+    const intptr_t firstLine = SendMessage(_hSC, SCI_DOCLINEFROMVISIBLE, firstVisibleLine, 0);
+    intptr_t lastLine = SendMessage(_hSC, SCI_DOCLINEFROMVISIBLE, firstVisibleLine + linesOnScreen, 0);
+    if (lastLine >= linesCount)
+        lastLine = linesCount - 1;
+
+    const intptr_t startPos = SendMessage(_hSC, SCI_POSITIONFROMLINE, firstLine, 0);
+    const intptr_t endPos   = SendMessage(_hSC, SCI_GETLINEENDPOSITION, lastLine, 0);
+
+    text.Resize(endPos - startPos + 1);
+
+    struct Sci_TextRangeFull tr;
+    tr.chrg.cpMin   = startPos;
+    tr.chrg.cpMax   = endPos;
+    tr.lpstrText    = text.C_str();
+
+    SendMessage(_hSC, SCI_GETTEXTRANGEFULL, 0, (LPARAM)&tr);
+    text.AutoFit();
+
+    return startPos;
+}
+
+
 /**
  *  \brief
  */
@@ -299,11 +299,29 @@ public:
         return SendMessage(_hSC, SCI_GETCURRENTPOS, 0, 0);
     }
 
+    inline void SetIndicatorStyle(int indic, int style) const
+    {
+        SendMessage(_hSC, SCI_INDICSETSTYLE, indic, style);
+    }
+
+    inline void ClearIndicator(int indic) const
+    {
+        SendMessage(_hSC, SCI_SETINDICATORCURRENT, indic, 0);
+        SendMessage(_hSC, SCI_INDICATORCLEARRANGE, 0, SendMessage(_hSC, SCI_GETLENGTH, 0, 0));
+    }
+
+    inline void SetIndicator(int indic, intptr_t pos, intptr_t len) const
+    {
+        SendMessage(_hSC, SCI_SETINDICATORCURRENT, indic, 0);
+        SendMessage(_hSC, SCI_INDICATORFILLRANGE, pos, len);
+    }
+
     void EnsureCurrentLineVisible() const;
     void SetView(intptr_t startPos, intptr_t endPos = 0) const;
 
     intptr_t GetWordSize(bool partial = false) const;
     void GetWord(CTextA& word, bool partial = false, bool select = false) const;
+    intptr_t GetVisibleText(CTextA& text) const;
     void ReplaceWord(const char* replText, bool partial = false) const;
     bool SearchText(const char* text, bool ignoreCase, bool wholeWord, bool regExp,
             intptr_t* startPos = NULL, intptr_t* endPos = NULL) const;
@@ -22,8 +22,12 @@
  */
 
 
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
 #include "LineParser.h"
 #include "StrUniquenessChecker.h"
+#include "Scanner.h"
 
 
 namespace GTags
@@ -41,14 +45,49 @@ intptr_t LineParser::Parse(const CmdPtr_t& cmd)
     StrUniquenessChecker<TCHAR> strChecker;
 
     _lines.clear();
-    _buf = cmd->Result();
 
-    TCHAR* pTmp = NULL;
-    for (TCHAR* pToken = _tcstok_s(_buf.C_str(), _T("\n\r"), &pTmp); pToken;
-            pToken = _tcstok_s(NULL, _T("\n\r"), &pTmp))
+    char* pSrc = cmd->Result();
+    char* const pEnd = pSrc + cmd->ResultLen();
+
+    // Each line is converted in place of its EOL char so the converted text never exceeds the source
+    _buf.resize(cmd->ResultLen() + 1);
+
+    std::vector<size_t> offsets;
+    size_t pos = 0;
+
+    Scanner::Line line;
+
+    while (pSrc < pEnd)
     {
-        if (cmd->Id() == FIND_FILE || cmd->Id() == AUTOCOMPLETE_FILE)
-            ++pToken;
+        Scanner::ScanLine(pSrc, pEnd, '\n', line);
+
+        char* pEol = const_cast<char*>(line.pEol);
+        const size_t len = pEol - pSrc;
+
+        if (len)
+        {
+            *pEol = 0;
+            offsets.push_back(pos);
+
+#ifdef UNICODE
+            size_t cnt;
+            mbstowcs_s(&cnt, &_buf[pos], len + 1, pSrc, _TRUNCATE);
+            pos += cnt;
+#else
+            memcpy(&_buf[pos], pSrc, len + 1);
+            pos += len + 1;
+#endif
+        }
+
+        pSrc = pEol + 1;
+    }
+
+    // Pointers are taken after the buffer is complete
+    const size_t skip = (cmd->Id() == FIND_FILE || cmd->Id() == AUTOCOMPLETE_FILE) ? 1 : 0;
+
+    for (size_t offset : offsets)
+    {
+        TCHAR* pToken = &_buf[offset] + skip;
 
         if ((!filterReoccurring) || strChecker.IsUnique(pToken))
         {
@@ -57,6 +96,18 @@ intptr_t LineParser::Parse(const CmdPtr_t& cmd)
         }
     }
 
+    // Tags and symbols completions are merged - sort them together and drop the duplicates
+    if (cmd->Id() == AUTOCOMPLETE && result > 1)
+    {
+        std::sort(_lines.begin(), _lines.end(),
+            [](const TCHAR* a, const TCHAR* b) { return (_tcscmp(a, b) < 0); });
+
+        _lines.erase(std::unique(_lines.begin(), _lines.end(),
+            [](const TCHAR* a, const TCHAR* b) { return !_tcscmp(a, b); }), _lines.end());
+
+        result = (intptr_t)_lines.size();
+    }
+
     return result;
 }
 
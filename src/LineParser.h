@@ -50,7 +50,7 @@ public:
     virtual intptr_t Parse(const CmdPtr_t&);
 
 private:
-    CText _buf;
+    std::vector<TCHAR> _buf;
 };
 
 } // namespace GTags
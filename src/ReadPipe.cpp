@@ -5,7 +5,7 @@
  *  \author  Pavel Nedev <pg.nedev@gmail.com>
  *
  *  \section COPYRIGHT
- *  Copyright(C) 2014-2015 Pavel Nedev
+ *  Copyright(C) 2014-2022 Pavel Nedev
  *
  *  \section LICENSE
  *  This program is free software; you can redistribute it and/or modify it
@@ -22,25 +22,56 @@
  */
 
 
+#include <tchar.h>
+#include <cstring>
 #include "ReadPipe.h"
-#include <process.h>
 
 
-const unsigned ReadPipe::cChunkSize = 4096;
+const DWORD ReadPipe::cPipeSize     = 64 * 1024;
+const DWORD ReadPipe::cMinChunkSize = 4096;
+const DWORD ReadPipe::cMaxChunkSize = 1024 * 1024;
+
+volatile LONG ReadPipe::PipeId = 0;
 
 
 /**
- *  \brief
+ *  \brief  Anonymous pipes don't support overlapped I/O so use uniquely named one instead
  */
-ReadPipe::ReadPipe() : _hIn(NULL), _hOut(NULL), _hThread(NULL)
+ReadPipe::ReadPipe() : _ready(FALSE), _hIn(NULL), _hOut(NULL), _pending(false),
+    _chunkSize(cMinChunkSize), _totalBytesRead(0), _lineCB(NULL), _lineCBContext(NULL),
+    _bytesReceived(0), _firstByteAt(0), _endAt(0)
 {
+    ZeroMemory(&_overlapped, sizeof(_overlapped));
+
+    _overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!_overlapped.hEvent)
+        return;
+
+    TCHAR pipeName[64];
+    _sntprintf_s(pipeName, _countof(pipeName), _TRUNCATE, _T("\\\\.\\pipe\\NppGTags.%08lx.%08lx"),
+            GetCurrentProcessId(), (unsigned long)InterlockedIncrement(&PipeId));
+
+    _hOut = CreateNamedPipe(pipeName, PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+            1, 0, cPipeSize, 0, NULL);
+    if (_hOut == INVALID_HANDLE_VALUE)
+    {
+        _hOut = NULL;
+        return;
+    }
+
     SECURITY_ATTRIBUTES attr    = {0};
     attr.nLength                = sizeof(attr);
     attr.bInheritHandle         = TRUE;
 
-    _ready = CreatePipe(&_hOut, &_hIn, &attr, 0);
-    if (_ready)
-        _ready = SetHandleInformation(_hOut, HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT);
+    _hIn = CreateFile(pipeName, GENERIC_WRITE, 0, &attr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (_hIn == INVALID_HANDLE_VALUE)
+    {
+        _hIn = NULL;
+        return;
+    }
+
+    _ready = TRUE;
 }
 
 
@@ -49,17 +80,20 @@ ReadPipe::ReadPipe() : _hIn(NULL), _hOut(NULL), _hThread(NULL)
  */
 ReadPipe::~ReadPipe()
 {
-    if (_hThread)
+    if (_pending)
     {
-        Wait(INFINITE);
-    }
-    else
-    {
-        if (_hIn)
-            CloseHandle(_hIn);
-        if (_hOut)
-            CloseHandle(_hOut);
+        DWORD bytesRead;
+
+        CancelIo(_hOut);
+        GetOverlappedResult(_hOut, &_overlapped, &bytesRead, TRUE);
     }
+
+    if (_hIn)
+        CloseHandle(_hIn);
+    if (_hOut)
+        CloseHandle(_hOut);
+    if (_overlapped.hEvent)
+        CloseHandle(_overlapped.hEvent);
 }
 
 
@@ -70,91 +104,236 @@ bool ReadPipe::Open()
 {
     if (!_ready || !_hOut)
         return false;
-    if (_hThread)
+    if (!_hIn)
         return true;
 
+    // Close our copy of the write end so reading ends when the process closes its copy
     CloseHandle(_hIn);
     _hIn = NULL;
-    _hThread = (HANDLE)_beginthreadex(NULL, 0, threadFunc, this, 0, NULL);
-    if (_hThread)
-        return true;
 
-    // on error
-    CloseHandle(_hOut);
-    _hOut = NULL;
-    return false;
+    readNext();
+
+    return true;
 }
 
 
 /**
  *  \brief
  */
-DWORD ReadPipe::Wait(DWORD time_ms)
+std::vector<char>& ReadPipe::GetOutput(DWORD time_ms)
 {
-    if (!_hThread)
-        return WAIT_OBJECT_0;
-
-    DWORD r = WaitForSingleObject(_hThread, time_ms);
-    if (r != WAIT_TIMEOUT)
+    if (_pending)
     {
-        CloseHandle(_hOut);
-        _hOut = NULL;
-        CloseHandle(_hThread);
-        _hThread = NULL;
+        ReadPipe* pipe = this;
+
+        if (Drain(&pipe, 1, NULL, 0, time_ms) == WAIT_TIMEOUT && _pending)
+            abandon();
     }
 
-    return r;
+    return _output;
 }
 
 
 /**
- *  \brief
+ *  \brief  Reads all pipes until one of the handles gets signaled, the time expires or the
+ *          pipes are closed. Returns WAIT_OBJECT_0 + index of the signaled handle or WAIT_TIMEOUT.
  */
-std::vector<char>& ReadPipe::GetOutput()
+DWORD ReadPipe::Drain(ReadPipe* const pipes[], unsigned pipesCount,
+        const HANDLE* handles, unsigned handlesCount, DWORD time_ms)
 {
-    if (_hThread)
-        Wait(INFINITE);
+    if (handlesCount + pipesCount > MAXIMUM_WAIT_OBJECTS)
+        return WAIT_FAILED;
 
-    return _output;
+    const DWORD startTime = GetTickCount();
+    bool polled = false;
+
+    for (;;)
+    {
+        HANDLE waitHandles[MAXIMUM_WAIT_OBJECTS];
+        ReadPipe* waitPipes[MAXIMUM_WAIT_OBJECTS];
+        DWORD count = 0;
+
+        // The given handles go first so they take precedence over pending pipe data
+        for (; count < handlesCount; ++count)
+            waitHandles[count] = handles[count];
+
+        for (unsigned i = 0; i < pipesCount; ++i)
+        {
+            if (pipes[i]->_pending)
+            {
+                waitPipes[count - handlesCount] = pipes[i];
+                waitHandles[count++] = pipes[i]->_overlapped.hEvent;
+            }
+        }
+
+        if (count == 0)
+            return WAIT_OBJECT_0;
+
+        DWORD waitTime = INFINITE;
+        if (time_ms != INFINITE)
+        {
+            const DWORD elapsed = GetTickCount() - startTime;
+            if (elapsed >= time_ms && polled)
+                return WAIT_TIMEOUT;
+
+            waitTime = (elapsed < time_ms) ? time_ms - elapsed : 0;
+            polled = true;
+        }
+
+        const DWORD r = WaitForMultipleObjects(count, waitHandles, FALSE, waitTime);
+        if (r == WAIT_TIMEOUT || r == WAIT_FAILED)
+            return r;
+
+        const DWORD handleId = r - WAIT_OBJECT_0;
+        if (handleId >= count)
+            return WAIT_FAILED;
+        if (handleId < handlesCount)
+            return r;
+
+        waitPipes[handleId - handlesCount]->readDone();
+    }
 }
 
 
 /**
- *  \brief
+ *  \brief  Issues next overlapped read growing the read size while the process output
+ *          keeps filling it up completely
  */
-unsigned __stdcall ReadPipe::threadFunc(void* data)
+void ReadPipe::readNext()
 {
-    return static_cast<ReadPipe*>(data)->thread();
+    if (_output.size() < _totalBytesRead + _chunkSize)
+        _output.resize(_totalBytesRead + _chunkSize);
+
+    if (!ReadFile(_hOut, _output.data() + _totalBytesRead, _chunkSize, NULL, &_overlapped) &&
+            GetLastError() != ERROR_IO_PENDING)
+    {
+        close();
+        return;
+    }
+
+    _pending = true;
 }
 
 
 /**
  *  \brief
  */
-unsigned ReadPipe::thread()
+void ReadPipe::readDone()
 {
     DWORD bytesRead = 0;
-    unsigned totalBytesRead = 0;
-    unsigned chunkRemainingSize = 0;
+
+    _pending = false;
+
+    if (!GetOverlappedResult(_hOut, &_overlapped, &bytesRead, FALSE))
+    {
+        close();
+        return;
+    }
+
+    if (bytesRead && _firstByteAt == 0)
+    {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        _firstByteAt = now.QuadPart;
+    }
+
+    _totalBytesRead += bytesRead;
+    _bytesReceived += bytesRead;
+
+    if (_lineCB)
+        splitLines(false);
+
+    if (bytesRead == _chunkSize && _chunkSize < cMaxChunkSize)
+        _chunkSize *= 2;
+
+    readNext();
+}
+
+
+/**
+ *  \brief  Passes the complete lines to the line callback and keeps only the incomplete last one.
+ *          On flush the last line is passed as well.
+ */
+void ReadPipe::splitLines(bool flush)
+{
+    if (flush)
+        _output.resize(_totalBytesRead + 1);
+
+    char* pLine = _output.data();
+    char* const pEnd = pLine + _totalBytesRead;
 
     for (;;)
     {
-        if (!chunkRemainingSize)
+        char* pEol = static_cast<char*>(memchr(pLine, '\n', pEnd - pLine));
+
+        if (pEol == NULL)
         {
-            _output.resize(totalBytesRead + cChunkSize);
-            chunkRemainingSize = cChunkSize;
+            if (!flush || pLine == pEnd)
+                break;
+
+            pEol = pEnd;
         }
 
-        if (!ReadFile(_hOut, _output.data() + totalBytesRead, chunkRemainingSize, &bytesRead, NULL))
+        char* pLineEnd = pEol;
+        if (pLineEnd > pLine && *(pLineEnd - 1) == '\r')
+            --pLineEnd;
+
+        *pLineEnd = 0;
+        _lineCB(_lineCBContext, pLine, pLineEnd - pLine);
+
+        if (pEol == pEnd)
+        {
+            pLine = pEnd;
             break;
+        }
 
-        chunkRemainingSize -= bytesRead;
-        totalBytesRead += bytesRead;
+        pLine = pEol + 1;
     }
 
-    _output.resize(totalBytesRead);
-    if (totalBytesRead)
-        _output.push_back(0);
+    _totalBytesRead = pEnd - pLine;
+    if (_totalBytesRead)
+        memmove(_output.data(), pLine, _totalBytesRead);
+}
 
-    return 0;
+
+/**
+ *  \brief  Stops reading - some other process still holds the pipe write end so it would never
+ *          get closed
+ */
+void ReadPipe::abandon()
+{
+    DWORD bytesRead = 0;
+
+    CancelIo(_hOut);
+
+    if (GetOverlappedResult(_hOut, &_overlapped, &bytesRead, TRUE))
+    {
+        _totalBytesRead += bytesRead;
+        _bytesReceived += bytesRead;
+    }
+
+    _pending = false;
+
+    close();
+}
+
+
+/**
+ *  \brief
+ */
+void ReadPipe::close()
+{
+    CloseHandle(_hOut);
+    _hOut = NULL;
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    _endAt = now.QuadPart;
+
+    if (_lineCB)
+        splitLines(true);
+
+    _output.resize(_totalBytesRead);
+    if (_totalBytesRead)
+        _output.push_back(0);
 }
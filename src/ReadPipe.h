@@ -26,37 +26,72 @@
 
 
 #include <windows.h>
+#include <cstdint>
 #include <vector>
 
 
 /**
  *  \class  ReadPipe
- *  \brief
+ *  \brief  Overlapped pipe reader - several pipes are drained together on the
+ *          calling thread by ReadPipe::Drain()
  */
 class ReadPipe
 {
 public:
+    typedef void (*LineCB_t)(void* context, char* line, size_t len);
+
     ReadPipe();
     ~ReadPipe();
 
     HANDLE GetInputHandle() { return _hIn; }
+
+    // If set, complete output lines are passed to lineCB as they arrive instead of being collected
+    void SetLineCallback(LineCB_t lineCB, void* context)
+    {
+        _lineCB = lineCB;
+        _lineCBContext = context;
+    }
+
     bool Open();
-    DWORD Wait(DWORD time_ms);
-    std::vector<char>& GetOutput();
 
-private:
-    static const unsigned cChunkSize;
+    // Output not read within time_ms is dropped
+    std::vector<char>& GetOutput(DWORD time_ms = INFINITE);
 
-    static unsigned __stdcall threadFunc(void* data);
+    // Performance counter time stamps, 0 if not reached yet
+    LONGLONG FirstByteTime() const { return _firstByteAt; }
+    LONGLONG EndTime() const { return _endAt; }
+
+    uint64_t BytesReceived() const { return _bytesReceived; }
+
+    static DWORD Drain(ReadPipe* const pipes[], unsigned pipesCount,
+            const HANDLE* handles, unsigned handlesCount, DWORD time_ms);
+
+private:
+    static const DWORD cPipeSize;
+    static const DWORD cMinChunkSize;
+    static const DWORD cMaxChunkSize;
+    static volatile LONG PipeId;
 
     ReadPipe(const ReadPipe&);
     const ReadPipe& operator=(const ReadPipe&);
 
-    unsigned thread();
+    void readNext();
+    void readDone();
+    void splitLines(bool flush);
+    void abandon();
+    void close();
 
     BOOL                _ready;
     HANDLE              _hIn;
     HANDLE              _hOut;
-    HANDLE              _hThread;
+    OVERLAPPED          _overlapped;
+    bool                _pending;
+    DWORD               _chunkSize;
+    size_t              _totalBytesRead;
     std::vector<char>   _output;
+    LineCB_t            _lineCB;
+    void*               _lineCBContext;
+    uint64_t            _bytesReceived;
+    LONGLONG            _firstByteAt;
+    LONGLONG            _endAt;
 };
@@ -0,0 +1,201 @@
+/**
+ *  \file
+ *  \brief  Cache of recent search results
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2022 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <iterator>
+#include "ResultCache.h"
+#include "Cmd.h"
+
+
+namespace GTags
+{
+
+// Memory all cached results can take
+const size_t ResultCache::cMaxSize = 64 * 1024 * 1024;
+
+
+/**
+ *  \brief  Restores the command results from the cache if the same search has been done already
+ *          and its database hasn't changed since
+ */
+bool ResultCache::Lookup(const CmdPtr_t& cmd)
+{
+    if (!cacheable(cmd))
+        return false;
+
+    std::list<Entry>::iterator entry = find(cmd);
+
+    if (entry == _entries.end())
+    {
+        ++_stats.misses;
+        return false;
+    }
+
+    if (entry->dbGeneration != cmd->_db->Generation())
+    {
+        erase(entry);
+        ++_stats.misses;
+        return false;
+    }
+
+    // Limited results are good only for the same limit
+    if (entry->truncated && entry->maxHits != cmd->_maxHits)
+    {
+        ++_stats.misses;
+        return false;
+    }
+
+    // Each command gets its own parser so the results window can tell their tabs apart
+    ParserPtr_t parser = entry->parser->Clone();
+    if (!parser)
+    {
+        ++_stats.misses;
+        return false;
+    }
+
+    _entries.splice(_entries.begin(), _entries, entry);
+
+    cmd->_parser        = parser;
+    cmd->_result        = entry->result;
+    cmd->_streamedLen   = entry->streamedLen;
+    cmd->_maxHits       = entry->maxHits;
+    cmd->_truncated     = entry->truncated;
+    cmd->_cached        = true;
+    cmd->_status        = OK;
+
+    ++_stats.hits;
+
+    return true;
+}
+
+
+/**
+ *  \brief  Stores successfully completed command results replacing the older ones of the same search.
+ *          The least recently used results are dropped to keep the cache memory bounded, results
+ *          bigger than that are not cached at all.
+ */
+void ResultCache::Put(const CmdPtr_t& cmd)
+{
+    if (cmd->_cached || cmd->_partial || cmd->_status != OK || !cmd->HasResult() || !cmd->_parser || !cacheable(cmd))
+        return;
+
+    std::list<Entry>::iterator entry = find(cmd);
+    if (entry != _entries.end())
+        erase(entry);
+
+    const size_t size = cmd->_parser->MemSize() + cmd->_result.capacity();
+    if (size > cMaxSize)
+        return;
+
+    _entries.emplace_front();
+
+    Entry& e        = _entries.front();
+    e.db            = cmd->_db;
+    e.dbGeneration  = cmd->_db->Generation();
+    e.id            = cmd->_id;
+    e.tag           = cmd->_tag;
+    e.ignoreCase    = cmd->_ignoreCase;
+    e.regExp        = cmd->_regExp;
+    e.skipLibs      = cmd->_skipLibs;
+    e.maxHits       = cmd->_maxHits;
+    e.truncated     = cmd->_truncated;
+    e.parser        = cmd->_parser;
+    e.result        = cmd->_result;
+    e.streamedLen   = cmd->_streamedLen;
+    e.size          = size;
+
+    _size += size;
+
+    while (_size > cMaxSize)
+    {
+        erase(std::prev(_entries.end()));
+        ++_stats.evictions;
+    }
+}
+
+
+/**
+ *  \brief
+ */
+void ResultCache::Clear()
+{
+    _entries.clear();
+    _size = 0;
+}
+
+
+/**
+ *  \brief  Only the search results are cached. Searches that include library databases are not as
+ *          their changes cannot be tracked. Greps read the source files directly and not the database
+ *          so its generation doesn't tell if their results are still valid.
+ */
+bool ResultCache::cacheable(const CmdPtr_t& cmd)
+{
+    if (!cmd->_db)
+        return false;
+
+    switch (cmd->_id)
+    {
+        case FIND_DEFINITION:
+        {
+            const DbConfig& cfg = cmd->_db->GetConfig();
+            return (cmd->_skipLibs || !cfg._useLibDb || cfg._libDbPaths.empty());
+        }
+
+        case FIND_FILE:
+        case FIND_REFERENCE:
+        case FIND_SYMBOL:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+
+/**
+ *  \brief
+ */
+std::list<ResultCache::Entry>::iterator ResultCache::find(const CmdPtr_t& cmd)
+{
+    std::list<Entry>::iterator entry;
+
+    for (entry = _entries.begin(); entry != _entries.end(); ++entry)
+        if (entry->db == cmd->_db && entry->id == cmd->_id && entry->tag == cmd->_tag &&
+                entry->ignoreCase == cmd->_ignoreCase && entry->regExp == cmd->_regExp &&
+                entry->skipLibs == cmd->_skipLibs)
+            break;
+
+    return entry;
+}
+
+/**
+ *  \brief
+ */
+void ResultCache::erase(std::list<Entry>::iterator entry)
+{
+    _size -= entry->size;
+    _entries.erase(entry);
+}
+
+} // namespace GTags
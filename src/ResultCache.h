@@ -0,0 +1,111 @@
+/**
+ *  \file
+ *  \brief  Cache of recent search results
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2022 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <cstdint>
+#include <list>
+#include <vector>
+#include "Common.h"
+#include "CmdDefines.h"
+#include "DbManager.h"
+
+
+namespace GTags
+{
+
+/**
+ *  \class  ResultCache
+ *  \brief  Keeps the parsed results of the most recently used searches until their database changes.
+ *          Accessed from the UI thread only.
+ */
+class ResultCache
+{
+public:
+    struct Stats
+    {
+        Stats() : entries(0), size(0), hits(0), misses(0), evictions(0) {}
+
+        size_t      entries;
+        size_t      size;
+        uint64_t    hits;
+        uint64_t    misses;
+        uint64_t    evictions;
+    };
+
+    static ResultCache& Get()
+    {
+        static ResultCache Instance;
+        return Instance;
+    }
+
+    bool Lookup(const CmdPtr_t& cmd);
+    void Put(const CmdPtr_t& cmd);
+    void Clear();
+
+    inline Stats GetStats() const
+    {
+        Stats stats = _stats;
+        stats.entries = _entries.size();
+        stats.size = _size;
+        return stats;
+    }
+
+private:
+    static const size_t cMaxSize;
+
+    struct Entry
+    {
+        DbHandle            db;
+        unsigned            dbGeneration;
+        CmdId_t             id;
+        CText               tag;
+        bool                ignoreCase;
+        bool                regExp;
+        bool                skipLibs;
+        size_t              maxHits;
+        bool                truncated;
+        ParserPtr_t         parser;
+        std::vector<char>   result;
+        size_t              streamedLen;
+        size_t              size;
+    };
+
+    ResultCache() : _size(0) {}
+    ResultCache(const ResultCache&);
+    ~ResultCache() {}
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    static bool cacheable(const CmdPtr_t& cmd);
+
+    std::list<Entry>::iterator find(const CmdPtr_t& cmd);
+    void erase(std::list<Entry>::iterator entry);
+
+    std::list<Entry>    _entries; // Most recently used first
+    size_t              _size;
+    Stats               _stats;
+};
+
+} // namespace GTags
@@ -0,0 +1,428 @@
+/**
+ *  \file
+ *  \brief  Compact search results model
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2022 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <tchar.h>
+#include <algorithm>
+#include "ResultSet.h"
+
+
+namespace GTags
+{
+
+const uint32_t ResultSet::cNone;
+
+// Bigger preview texts are moved out of memory to a temporary file while the results are being made
+const size_t ResultSet::cSpillThreshold = 16 * 1024 * 1024;
+const size_t ResultSet::cSpillChunk     = 1024 * 1024;
+
+
+/**
+ *  \brief  Maps just the needed range of the spilled text and just while the view is in use
+ */
+ResultSet::TextView::TextView(const ResultSet& results, size_t begin, size_t end) :
+    _hMap(NULL), _pView(NULL), _text(NULL)
+{
+    const size_t spilled = results._spilledSize;
+
+    if (begin >= spilled)
+    {
+        if (!results._arena.empty())
+            _text = results._arena.data() + (begin - spilled);
+        return;
+    }
+
+    // Views start at allocation granularity boundary
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+
+    const uint64_t offset = begin - begin % si.dwAllocationGranularity;
+    const size_t mapEnd = (end < spilled) ? end : spilled;
+
+    _hMap = CreateFileMapping(results._hSpillFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (_hMap)
+        _pView = MapViewOfFile(_hMap, FILE_MAP_READ, (DWORD)(offset >> 32), (DWORD)offset,
+                mapEnd - (size_t)offset);
+
+    if (!_pView)
+        return;
+
+    _text = static_cast<const char*>(_pView) + (begin - (size_t)offset);
+
+    if (end > spilled)
+    {
+        _joined.reserve(end - begin);
+        _joined.assign(_text, _text + (spilled - begin));
+        _joined.insert(_joined.end(), results._arena.data(), results._arena.data() + (end - spilled));
+
+        _text = _joined.data();
+    }
+}
+
+
+/**
+ *  \brief
+ */
+ResultSet::TextView::~TextView()
+{
+    if (_pView)
+        UnmapViewOfFile(_pView);
+
+    if (_hMap)
+        CloseHandle(_hMap);
+}
+
+
+/**
+ *  \brief
+ */
+void ResultSet::Clear()
+{
+    if (_hSpillFile)
+    {
+        CloseHandle(_hSpillFile);
+        _hSpillFile = NULL;
+    }
+
+    _spilledSize = 0;
+    _spillFailed = false;
+
+    _rowsCount = 1;
+
+    _fileNames.clear();
+    _fileRows.clear();
+    _fileIds.clear();
+
+    _groupFiles.clear();
+    _groupRows.clear();
+    _groupHits.clear();
+
+    _hitLines.clear();
+    _hitTexts.clear();
+
+    _arena.clear();
+    _textSize = 0;
+}
+
+
+/**
+ *  \brief  Returns the memory taken by the results, spilled preview texts are not counted
+ */
+size_t ResultSet::MemSize() const
+{
+    size_t size = _arena.capacity();
+
+    size += (_fileRows.capacity() + _groupFiles.capacity() + _groupRows.capacity() + _groupHits.capacity() +
+            _hitLines.capacity() + _hitTexts.capacity()) * sizeof(uint32_t);
+
+    size += _fileNames.capacity() * sizeof(const std::string*);
+
+    // File names are counted twice - for the name and for its interning map node
+    for (const std::string* name : _fileNames)
+        size += name->capacity() + 2 * sizeof(std::string);
+
+    return size;
+}
+
+
+/**
+ *  \brief  Adds file row starting new hits group. Returns the file ID.
+ */
+uint32_t ResultSet::AddFile(const char* pFile, size_t len)
+{
+    const auto file = _fileIds.emplace(std::string(pFile, len), (uint32_t)_fileNames.size());
+
+    // Map keys are not moved on rehash so they can be referred to directly
+    if (file.second)
+    {
+        _fileNames.push_back(&file.first->first);
+        _fileRows.push_back((uint32_t)_rowsCount);
+    }
+
+    _groupFiles.push_back(file.first->second);
+    _groupRows.push_back((uint32_t)_rowsCount);
+    _groupHits.push_back(HitsCount());
+
+    ++_rowsCount;
+
+    return file.first->second;
+}
+
+
+/**
+ *  \brief  Adds hit row to the last added file
+ */
+void ResultSet::AddHit(uint32_t line, const char* pText, size_t len)
+{
+    // Preview texts are addressed with 32-bit offsets
+    if (_textSize + len >= cNone)
+        len = 0;
+
+    _hitLines.push_back(line);
+    _hitTexts.push_back((uint32_t)_textSize);
+
+    appendText(pText, len);
+
+    ++_rowsCount;
+}
+
+
+/**
+ *  \brief  Replaces the results with a copy of the given ones. The preview texts are copied chunk by
+ *          chunk so bigger ones are spilled again on the way.
+ */
+void ResultSet::CopyFrom(const ResultSet& results)
+{
+    Clear();
+
+    // The interning map is rebuilt so the file names point to its own keys
+    for (const std::string* name : results._fileNames)
+    {
+        const auto file = _fileIds.emplace(*name, FilesCount());
+        _fileNames.push_back(&file.first->first);
+    }
+
+    _rowsCount  = results._rowsCount;
+    _fileRows   = results._fileRows;
+    _groupFiles = results._groupFiles;
+    _groupRows  = results._groupRows;
+    _groupHits  = results._groupHits;
+    _hitLines   = results._hitLines;
+    _hitTexts   = results._hitTexts;
+
+    for (size_t begin = 0; begin < results._textSize; begin += cSpillChunk)
+    {
+        const size_t end = (results._textSize - begin > cSpillChunk) ? begin + cSpillChunk : results._textSize;
+        const TextView view(results, begin, end);
+
+        if (view.Data())
+        {
+            appendText(view.Data(), end - begin);
+        }
+        else
+        {
+            const std::vector<char> blank(end - begin, ' ');
+            appendText(blank.data(), blank.size());
+        }
+    }
+}
+
+
+/**
+ *  \brief  Starts spilling the preview texts once they grow over the threshold, then keeps appending
+ *          them to the spill file in chunks
+ */
+void ResultSet::appendText(const char* pText, size_t len)
+{
+    _arena.insert(_arena.end(), pText, pText + len);
+    _textSize += len;
+
+    if (!_spillFailed && _arena.size() > (_hSpillFile ? cSpillChunk : cSpillThreshold))
+        spill();
+}
+
+
+/**
+ *  \brief  Moves the preview texts in memory to a temporary file that is deleted once the results are
+ *          gone. Keeps all further texts in memory if that fails.
+ */
+bool ResultSet::spill()
+{
+    if (!_hSpillFile)
+    {
+        TCHAR tmpPath[MAX_PATH];
+        TCHAR tmpFile[MAX_PATH];
+
+        if (!GetTempPath(_countof(tmpPath), tmpPath) || !GetTempFileName(tmpPath, _T("gtr"), 0, tmpFile))
+        {
+            _spillFailed = true;
+            return false;
+        }
+
+        HANDLE hFile = CreateFile(tmpFile, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+
+        if (hFile == INVALID_HANDLE_VALUE)
+        {
+            DeleteFile(tmpFile);
+            _spillFailed = true;
+            return false;
+        }
+
+        _hSpillFile = hFile;
+    }
+
+    const char* pData = _arena.data();
+    size_t remaining = _arena.size();
+
+    while (remaining)
+    {
+        const DWORD chunk = (remaining > 0x4000000) ? 0x4000000 : (DWORD)remaining;
+        DWORD written;
+
+        if (!WriteFile(_hSpillFile, pData, chunk, &written, NULL) || written != chunk)
+        {
+            // Drop what was written partially so the file holds exactly the spilled texts
+            LARGE_INTEGER pos;
+            pos.QuadPart = _spilledSize;
+            SetFilePointerEx(_hSpillFile, pos, NULL, FILE_BEGIN);
+            SetEndOfFile(_hSpillFile);
+
+            _spillFailed = true;
+            return false;
+        }
+
+        pData += chunk;
+        remaining -= chunk;
+    }
+
+    _spilledSize += _arena.size();
+
+    // The arena grown up to the threshold is released
+    if (_arena.capacity() > 2 * cSpillChunk)
+    {
+        std::vector<char>().swap(_arena);
+        _arena.reserve(2 * cSpillChunk);
+    }
+    else
+    {
+        _arena.clear();
+    }
+
+    return true;
+}
+
+
+/**
+ *  \brief  Gets the file and the hit shown on the row
+ */
+bool ResultSet::GetRow(intptr_t rowNum, Row& row) const
+{
+    if (rowNum < 1 || rowNum >= _rowsCount)
+        return false;
+
+    const size_t group = findGroup(rowNum);
+
+    row.file = _groupFiles[group];
+    row.hit = (_groupRows[group] == rowNum) ? cNone :
+            _groupHits[group] + (uint32_t)(rowNum - _groupRows[group] - 1);
+
+    return true;
+}
+
+
+/**
+ *  \brief
+ */
+uint32_t ResultSet::FindFile(const std::string& file) const
+{
+    const auto found = _fileIds.find(file);
+
+    return (found != _fileIds.end()) ? found->second : cNone;
+}
+
+
+/**
+ *  \brief  Appends the text of the rows starting from fromRow, each one on a new line. Renders maxRows
+ *          at most (all if 0) so the text can be paged. Returns the row to continue from.
+ */
+intptr_t ResultSet::Render(std::string& text, intptr_t fromRow, intptr_t maxRows) const
+{
+    if (fromRow < 1)
+        fromRow = 1;
+
+    if (fromRow >= _rowsCount)
+        return _rowsCount;
+
+    const intptr_t toRow = (maxRows > 0 && _rowsCount - fromRow > maxRows) ? fromRow + maxRows : _rowsCount;
+
+    size_t group = findGroup(fromRow);
+
+    bool fileRow = (_groupRows[group] == fromRow);
+    uint32_t hit = _groupHits[group];
+    if (!fileRow)
+        hit += (uint32_t)(fromRow - _groupRows[group] - 1);
+
+    // Only the preview texts of the rendered hits are accessed
+    const size_t lastGroup = findGroup(toRow - 1);
+    const uint32_t hitsEnd = _groupHits[lastGroup] + (uint32_t)(toRow - 1 - _groupRows[lastGroup]);
+
+    const size_t textBegin = (hit < HitsCount()) ? _hitTexts[hit] : _textSize;
+    const size_t textEnd = (hitsEnd < HitsCount()) ? _hitTexts[hitsEnd] : _textSize;
+
+    text.reserve(text.size() + (textEnd - textBegin) + (size_t)(toRow - fromRow) * 16);
+
+    const TextView view(*this, textBegin, textEnd);
+    const char* pText = view.Data();
+
+    for (intptr_t row = fromRow; row < toRow; ++group, fileRow = true)
+    {
+        if (fileRow)
+        {
+            text += "\n\t";
+            text += FileName(_groupFiles[group]);
+            ++row;
+        }
+
+        const uint32_t groupEnd = (group + 1 < _groupHits.size()) ? _groupHits[group + 1] : HitsCount();
+
+        for (; hit < groupEnd && row < toRow; ++hit, ++row)
+        {
+            const size_t hitTextEnd = (hit + 1 < HitsCount()) ? _hitTexts[hit + 1] : _textSize;
+
+            text += "\n\t\tline ";
+            text += std::to_string(_hitLines[hit]);
+            text += ":\t";
+
+            if (pText)
+                text.append(pText + (_hitTexts[hit] - textBegin), hitTextEnd - _hitTexts[hit]);
+        }
+    }
+
+    return toRow;
+}
+
+
+/**
+ *  \brief
+ */
+intptr_t ResultSet::PreviewPos(uint32_t line)
+{
+    intptr_t pos = 10;
+
+    for (; line >= 10; line /= 10)
+        ++pos;
+
+    return pos;
+}
+
+
+/**
+ *  \brief  Finds the last group starting at or before the row
+ */
+size_t ResultSet::findGroup(intptr_t rowNum) const
+{
+    return std::upper_bound(_groupRows.begin(), _groupRows.end(), (uint32_t)rowNum) - _groupRows.begin() - 1;
+}
+
+} // namespace GTags
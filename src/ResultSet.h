@@ -0,0 +1,143 @@
+/**
+ *  \file
+ *  \brief  Compact search results model
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2022 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+
+namespace GTags
+{
+
+/**
+ *  \class  ResultSet
+ *  \brief  Search results kept as interned file names, integer line numbers and preview texts packed
+ *          in one arena. Rows are numbered as they are shown - row 0 is left for the search header,
+ *          each group of consecutive hits in the same file is shown under its file row.
+ */
+class ResultSet
+{
+public:
+    static const uint32_t cNone = UINT32_MAX;
+
+    struct Row
+    {
+        uint32_t file;
+        uint32_t hit;   // cNone on file rows
+    };
+
+    /**
+     *  \class  TextView
+     *  \brief  Gives access to a range of the preview texts wherever it is - in memory or spilled to disk
+     */
+    class TextView
+    {
+    public:
+        TextView(const ResultSet& results, size_t begin, size_t end);
+        ~TextView();
+
+        // Text at the range begin, NULL if the text cannot be accessed
+        inline const char* Data() const { return _text; }
+
+    private:
+        TextView(const TextView&);
+        TextView& operator=(const TextView&) = delete;
+
+        HANDLE              _hMap;
+        const void*         _pView;
+        const char*         _text;
+        std::vector<char>   _joined;    // Range that is partly spilled and partly still in memory
+    };
+
+    ResultSet() : _rowsCount(1), _textSize(0), _hSpillFile(NULL), _spilledSize(0), _spillFailed(false) {}
+    ~ResultSet()
+    {
+        if (_hSpillFile)
+            CloseHandle(_hSpillFile);
+    }
+
+    void Clear();
+
+    uint32_t AddFile(const char* pFile, size_t len);
+    void AddHit(uint32_t line, const char* pText, size_t len);
+    void CopyFrom(const ResultSet& results);
+
+    bool GetRow(intptr_t rowNum, Row& row) const;
+    uint32_t FindFile(const std::string& file) const;
+    intptr_t Render(std::string& text, intptr_t fromRow, intptr_t maxRows = 0) const;
+
+    inline intptr_t RowsCount() const { return _rowsCount; }
+    inline uint32_t FilesCount() const { return (uint32_t)_fileNames.size(); }
+    inline uint32_t HitsCount() const { return (uint32_t)_hitLines.size(); }
+    inline size_t TextSize() const { return _textSize; }
+    size_t MemSize() const;
+
+    inline const std::string& FileName(uint32_t file) const { return *_fileNames[file]; }
+    inline intptr_t FileRow(uint32_t file) const { return _fileRows[file]; }
+    inline uint32_t HitLine(uint32_t hit) const { return _hitLines[hit]; }
+
+    // Offset of the preview text in the shown hit row - "\t\tline N:\t"
+    static intptr_t PreviewPos(uint32_t line);
+
+private:
+    static const size_t cSpillThreshold;
+    static const size_t cSpillChunk;
+
+    ResultSet(const ResultSet&);
+    ResultSet& operator=(const ResultSet&) = delete;
+
+    void appendText(const char* pText, size_t len);
+    bool spill();
+    size_t findGroup(intptr_t rowNum) const;
+
+    intptr_t    _rowsCount;
+
+    // Files in the order they first appear, the names are the keys of the interning map
+    std::unordered_map<std::string, uint32_t>   _fileIds;
+    std::vector<const std::string*>             _fileNames;
+    std::vector<uint32_t>                       _fileRows;
+
+    // Groups of consecutive hits in the same file
+    std::vector<uint32_t>   _groupFiles;
+    std::vector<uint32_t>   _groupRows;
+    std::vector<uint32_t>   _groupHits;
+
+    // Hits - preview text ends where the next one starts
+    std::vector<uint32_t>   _hitLines;
+    std::vector<uint32_t>   _hitTexts;
+
+    // Once spilled the arena holds only the texts not written to the file yet
+    std::vector<char>       _arena;
+    size_t                  _textSize;
+    HANDLE                  _hSpillFile;
+    size_t                  _spilledSize;
+    bool                    _spillFailed;
+};
+
+} // namespace GTags
@@ -37,10 +37,12 @@
 #include <commctrl.h>
 #include <vector>
 #include <string>
+#include <memory>
 #include "Common.h"
 #include "GTags.h"
 #include "NppAPI/dockingResource.h"
 #include "StrUniquenessChecker.h"
+#include "Scanner.h"
 
 
 // Scintilla user defined styles IDs
@@ -74,111 +76,289 @@ const int ResultWin::cSearchWidth           = 420;
 
 ResultWin* ResultWin::RW = NULL;
 
+// Results text is composed and passed to the view in pages of that many rows
+const intptr_t ResultWin::cPageRows         = 4096;
+
 
 /**
  *  \brief
  */
 intptr_t ResultWin::TabParser::Parse(const CmdPtr_t& cmd)
 {
+    AUTOLOCK(_lock);
+
+    Begin(cmd);
+
+    const DbConfig& cfg = cmd->Db()->GetConfig();
+    const bool findFile = (cmd->Id() == FIND_FILE);
+
+    char* pSrc = cmd->Result();
+    char* const pEnd = pSrc + cmd->ResultLen();
+
+    Scanner::Line line;
+
+    while (pSrc < pEnd)
+    {
+        Scanner::ScanLine(pSrc, pEnd, ':', line);
+
+        char* pEol = const_cast<char*>(line.pEol);
+
+        if (pEol > pSrc)
+        {
+            *pEol = 0;
+
+            const bool parsed = findFile ? parseFindFileLine(cfg, pSrc, pEol - pSrc) :
+                    parseCmdLine(cfg, pSrc, pEol - pSrc, line);
+            if (!parsed)
+                return -1;
+        }
+
+        pSrc = pEol + 1;
+    }
+
+    return End(cmd);
+}
+
+
+/**
+ *  \brief
+ */
+void ResultWin::TabParser::Begin(const CmdPtr_t& cmd)
+{
+    AUTOLOCK(_lock);
+
+    _cmdId = cmd->Id();
+    _shownLive = false;
+
     _filesCount = 0;
     _hits = 0;
     _headerStatusLen = 0;
 
-    _fileResults.clear();
+    _moreLine = 0;
+    _moreText.Clear();
+    _previousFile.clear();
+    _previousFileFiltered = false;
+    _strChecker.Clear();
+
+    _results.Clear();
+
+    _filterReoccurring = false;
+
+    const DbConfig& cfg = cmd->Db()->GetConfig();
+    if (cmd->Id() == FIND_DEFINITION && cfg._useLibDb)
+    {
+        for (const auto& libPath : cfg._libDbPaths)
+        {
+            if (libPath.IsParentOf(cmd->Db()->GetPath()))
+            {
+                _filterReoccurring = true;
+                break;
+            }
+        }
+    }
 
     // Add the search header - cmd name + search word + project path
-    _buf = cmd->Name();
-    _buf += " \"";
-    _buf += cmd->Tag().C_str();
-    _buf += "\"";
+    _header = cmd->Name();
+    _header += " \"";
+    _header += cmd->Tag().C_str();
+    _header += "\"";
 
     if (cmd->RegExp() || cmd->IgnoreCase())
     {
-        _buf += " (";
+        _header += " (";
 
         if (cmd->RegExp())
         {
-            _buf += "regexp";
+            _header += "regexp";
 
             if (cmd->IgnoreCase())
-                _buf += ", ";
+                _header += ", ";
         }
 
         if (cmd->IgnoreCase())
-            _buf += "ignore case";
+            _header += "ignore case";
 
-        _buf += ")";
+        _header += ")";
     }
 
-    _buf += " in \"";
-    _buf += cmd->Db()->GetPath().C_str();
-    _buf += "\"";
+    _header += " in \"";
+    _header += cmd->Db()->GetPath().C_str();
+    _header += "\"";
+}
+
 
-    const size_t countsPos = _buf.Len();
+/**
+ *  \brief  Parses single null-terminated output line
+ */
+bool ResultWin::TabParser::ParseLine(const CmdPtr_t& cmd, char* pLine, size_t len)
+{
+    AUTOLOCK(_lock);
 
-    intptr_t res;
+    const DbConfig& cfg = cmd->Db()->GetConfig();
 
-    // parsing command result
     if (cmd->Id() == FIND_FILE)
+        return parseFindFileLine(cfg, pLine, len);
+
+    Scanner::Line line;
+    Scanner::ScanLine(pLine, pLine + len, ':', line);
+
+    return parseCmdLine(cfg, pLine, len, line);
+}
+
+
+/**
+ *  \brief
+ */
+intptr_t ResultWin::TabParser::End(const CmdPtr_t& cmd)
+{
+    AUTOLOCK(_lock);
+
+    // The seen entries copy is not needed once parsed
+    _strChecker.Clear();
+
+    const intptr_t res = (cmd->Id() == FIND_FILE) ? _filesCount : _hits;
+
+    // Results sumary is shown in the header
+    if (res > 0)
     {
-        res = parseFindFile(cmd);
+        _headerStatusLen = (int)getStatus().size();
 
-        // Add results sumary in header
-        if (res > 0)
+        // Time limit reached - add entry to run the search with no limit
+        if (cmd->IsPartial())
         {
-            std::string str = " (";
-
-            if (_filesCount == 1)
-            {
-                str += "1 hit)";
-            }
-            else
-            {
-                str += std::to_string(_filesCount);
-                str += " hits)";
-            }
+            _moreLine = _results.RowsCount();
 
-            _headerStatusLen = (int)str.size();
+            _moreText = "\n\t[...] search stopped after ";
+            _moreText += std::to_string(cmd->Deadline()).c_str();
+            _moreText += " ms - double-click here to run it with no time limit";
+        }
+        // Output limit reached - add entry to load the rest of the results
+        else if (cmd->IsTruncated())
+        {
+            _moreLine = _results.RowsCount();
 
-            _buf.Insert(countsPos, str.c_str(), str.size());
+            _moreText = "\n\t[...] results limited to ";
+            _moreText += std::to_string(cmd->MaxHits()).c_str();
+            _moreText += " lines - double-click here to load more";
         }
     }
-    else
+
+    return res;
+}
+
+
+/**
+ *  \brief  Copies the parsed results for a command that reuses them from the results cache
+ */
+ParserPtr_t ResultWin::TabParser::Clone() const
+{
+    AUTOLOCK(_lock);
+
+    TabParser* parser = new TabParser;
+
+    parser->_cmdId              = _cmdId;
+    parser->_filesCount         = _filesCount;
+    parser->_hits               = _hits;
+    parser->_headerStatusLen    = _headerStatusLen;
+    parser->_header             = _header;
+    parser->_moreText           = _moreText;
+    parser->_moreLine           = _moreLine;
+    parser->_filterReoccurring  = _filterReoccurring;
+
+    parser->_results.CopyFrom(_results);
+
+    return ParserPtr_t(parser);
+}
+
+
+/**
+ *  \brief
+ */
+size_t ResultWin::TabParser::MemSize() const
+{
+    AUTOLOCK(_lock);
+
+    return _results.MemSize() + _header.Size() + _moreText.Size() + _previousFile.capacity();
+}
+
+
+/**
+ *  \brief  Composes the results text starting from the given row - the header is row 0. Composes
+ *          maxRows at most (all if 0). Returns the row to continue from - the rows count once all
+ *          rows so far are composed.
+ */
+intptr_t ResultWin::TabParser::getText(std::string& text, intptr_t fromRow, intptr_t maxRows) const
+{
+    AUTOLOCK(_lock);
+
+    if (fromRow == 0)
     {
-        res = parseCmd(cmd);
+        text += _header.C_str();
+        text += getStatus();
+    }
+
+    const intptr_t nextRow = _results.Render(text, fromRow, maxRows);
+
+    if (_moreLine && nextRow == _results.RowsCount())
+        text += _moreText.C_str();
+
+    return nextRow;
+}
+
 
-        // Add results sumary in header
-        if (res > 0)
+/**
+ *  \brief  Returns the results summary for the header
+ */
+std::string ResultWin::TabParser::getStatus() const
+{
+    std::string str;
+
+    if (_cmdId == FIND_FILE)
+    {
+        if (_filesCount == 0)
+            return str;
+
+        str = " (";
+
+        if (_filesCount == 1)
+        {
+            str += "1 hit)";
+        }
+        else
         {
-            std::string str = " (";
+            str += std::to_string(_filesCount);
+            str += " hits)";
+        }
 
-            if (_hits == 1)
-            {
-                str += "1 hit in 1 file)";
-            }
-            else
-            {
-                str += std::to_string(_hits);
-                str += " hits in ";
+        return str;
+    }
 
-                if (_filesCount == 1)
-                {
-                    str += "1 file)";
-                }
-                else
-                {
-                    str += std::to_string(_filesCount);
-                    str += " files)";
-                }
-            }
+    if (_hits == 0)
+        return str;
 
-            _headerStatusLen = (int)str.size();
+    str = " (";
 
-            _buf.Insert(countsPos, str.c_str(), str.size());
+    if (_hits == 1)
+    {
+        str += "1 hit in 1 file)";
+    }
+    else
+    {
+        str += std::to_string(_hits);
+        str += " hits in ";
+
+        if (_filesCount == 1)
+        {
+            str += "1 file)";
+        }
+        else
+        {
+            str += std::to_string(_filesCount);
+            str += " files)";
         }
     }
 
-    return res;
+    return str;
 }
 
 
@@ -206,155 +386,99 @@ bool ResultWin::TabParser::filterEntry(const DbConfig& cfg, const char* pEntry,
 /**
  *  \brief
  */
-intptr_t ResultWin::TabParser::parseFindFile(const CmdPtr_t& cmd)
+bool ResultWin::TabParser::parseFindFileLine(const DbConfig& cfg, const char* pLine, size_t len)
 {
-    const char* pSrc = cmd->Result();
-    const char* pEol;
+    const char* pEnd = pLine + len;
 
-    const DbConfig& cfg = cmd->Db()->GetConfig();
+    while (pLine < pEnd && (*pLine == ' ' || *pLine == '\t'))
+        ++pLine;
+    if (pLine == pEnd)
+        return true;
 
-    for (;;)
+    if (!filterEntry(cfg, pLine, pEnd - pLine))
     {
-        while (*pSrc == '\n' || *pSrc == '\r' || *pSrc == ' ' || *pSrc == '\t')
-            ++pSrc;
-        if (*pSrc == 0) break;
-
-        pEol = pSrc;
-        while (*pEol != '\n' && *pEol != '\r' && *pEol != 0)
-            ++pEol;
-
-        if (!filterEntry(cfg, pSrc, pEol - pSrc))
-        {
-            _buf += "\n\t";
-            _buf.Append(pSrc, pEol - pSrc);
-
-            addResultFile(pSrc, pEol - pSrc, 0);
-
-            ++_filesCount;
-        }
-
-        pSrc = pEol;
+        _results.AddFile(pLine, pEnd - pLine);
+        ++_filesCount;
     }
 
-    return _filesCount;
+    return true;
 }
 
 
 /**
- *  \brief
+ *  \brief  Parses grep format line - "file:line:text". The ':' separators positions are already found
+ *          by the scanner.
  */
-intptr_t ResultWin::TabParser::parseCmd(const CmdPtr_t& cmd)
+bool ResultWin::TabParser::parseCmdLine(const DbConfig& cfg, char* pLine, size_t len, const Scanner::Line& line)
 {
-    bool filterReoccurring = false;
-
-    const DbConfig& cfg = cmd->Db()->GetConfig();
-    if (cmd->Id() == FIND_DEFINITION && cfg._useLibDb)
-    {
-        for (const auto& libPath : cfg._libDbPaths)
-        {
-            if (libPath.IsParentOf(cmd->Db()->GetPath()))
-            {
-                filterReoccurring = true;
-                break;
-            }
-        }
-    }
-
-    StrUniquenessChecker<char> strChecker;
-
-    char*       pSrc = cmd->Result();
-    char*       pIdx;
+    if (len == 0)
+        return true;
 
-    const char* pLine;
-    const char* pPreviousFile = NULL;
-    unsigned    previousFileLen = 0;
-    bool        previousFileFiltered = false;
+    const char* pEnd = pLine + len;
+    unsigned sep = 0;
 
-    size_t      previousBufLen;
+    if (sep == line.sepsCount)
+        return false;
 
-    intptr_t    line = 0;
+    const char* pIdx = line.pSeps[sep++];
 
-    for (;;)
+    // Path is absolute (starts with drive letter)
+    if ((pIdx - pLine == 1) && (pIdx + 1 < pEnd) && ((*(pIdx + 1) == '\\') || (*(pIdx + 1) == '/')))
     {
-        while (*pSrc == '\n' || *pSrc == '\r')
-            ++pSrc;
-        if (*pSrc == 0) break;
-
-        previousBufLen = _buf.Len();
-        pLine = pSrc;
-
-        pIdx = pSrc;
-        while (*pIdx != ':')
-            ++pIdx;
-
-        // Path is absolute (starts with drive letter)
-        if ((pIdx - pSrc == 1) && ((*(pIdx + 1) == '\\') || (*(pIdx + 1) == '/')))
-            while (*++pIdx != ':');
-
-        // add new file name to the UI buffer only if it is different
-        // than the previous one
-        if ((pPreviousFile == NULL) || ((unsigned)(pIdx - pSrc) != previousFileLen) ||
-            strncmp(pSrc, pPreviousFile, previousFileLen))
-        {
-            pPreviousFile = pSrc;
-            previousFileLen = (unsigned)(pIdx - pSrc);
+        if (sep == line.sepsCount)
+            return false;
 
-            if (filterEntry(cfg, pPreviousFile, previousFileLen))
-            {
-                previousFileFiltered = true;
-            }
-            else
-            {
-                ++line;
-                _buf += "\n\t";
-                _buf.Append(pPreviousFile, previousFileLen);
+        pIdx = line.pSeps[sep++];
+    }
 
-                addResultFile(pPreviousFile, previousFileLen, line);
+    const size_t fileLen = pIdx - pLine;
 
-                ++_filesCount;
+    // New file rows are added only if the file is different than the previous one
+    const bool fileNew = (_previousFile.empty() || fileLen != _previousFile.size() ||
+            _previousFile.compare(0, fileLen, pLine, fileLen));
 
-                previousFileFiltered = false;
-            }
-        }
+    if (fileNew)
+    {
+        _previousFile.assign(pLine, fileLen);
+        _previousFileFiltered = filterEntry(cfg, pLine, fileLen);
+    }
 
-        if (previousFileFiltered)
-        {
-            while (*pSrc != '\n' && *pSrc != '\r')
-                ++pSrc;
-            continue;
-        }
+    if (_previousFileFiltered)
+        return true;
 
-        pSrc = ++pIdx;
-        while (*pSrc != ':')
-            ++pSrc;
+    const char* pLineNum = pIdx + 1;
 
-        ++line;
-        _buf += "\n\t\tline ";
-        _buf.Append(pIdx, pSrc - pIdx);
-        _buf += ":\t";
+    if (sep == line.sepsCount)
+        return false;
 
-        pIdx = ++pSrc;
-        while (*pIdx == ' ' || *pIdx == '\t')
-            ++pIdx;
+    pIdx = line.pSeps[sep++];
 
-        pSrc = pIdx + 1;
-        while (*pSrc != '\n' && *pSrc != '\r')
-            ++pSrc;
+    const uint32_t lineNum = (uint32_t)strtoul(pLineNum, NULL, 10);
 
-        if (pSrc == pIdx + 1)
-            return -1;
+    ++pIdx;
+    // Matched text can be empty - greps for blank lines
+    while (pIdx < pEnd && (*pIdx == ' ' || *pIdx == '\t'))
+        ++pIdx;
 
-        _buf.Append(pIdx, pSrc - pIdx);
+    // Drop the repeated entry - its file row is added with the next entry if that was the first one for it
+    if (_filterReoccurring && !_strChecker.IsUnique(pLine, len))
+    {
+        if (fileNew)
+            _previousFile.clear();
 
-        *pSrc++ = 0;
+        return true;
+    }
 
-        if (filterReoccurring && !strChecker.IsUnique(pLine))
-            _buf.Resize(previousBufLen);
-        else
-            ++_hits;
+    if (fileNew)
+    {
+        _results.AddFile(pLine, fileLen);
+        ++_filesCount;
     }
 
-    return _hits;
+    _results.AddHit(lineNum, pIdx, pEnd - pIdx);
+    ++_hits;
+
+    return true;
 }
 
 
@@ -362,9 +486,10 @@ intptr_t ResultWin::TabParser::parseCmd(const CmdPtr_t& cmd)
  *  \brief
  */
 ResultWin::Tab::Tab(const CmdPtr_t& cmd) :
-    _cmdId(cmd->Id()), _regExp(cmd->RegExp()), _ignoreCase(cmd->IgnoreCase()),
-    _projectPath(cmd->Db()->GetPath().C_str()), _search(cmd->Tag().C_str()), _currentLine(1), _firstVisibleLine(0),
-    _parser(cmd->Parser()), _dirty(false)
+    _cmdId(cmd->Id()), _regExp(cmd->RegExp()), _ignoreCase(cmd->IgnoreCase()), _maxHits(cmd->MaxHits()),
+    _partial(cmd->IsPartial()), _projectPath(cmd->Db()->GetPath().C_str()), _search(cmd->Tag().C_str()),
+    _currentLine(1), _firstVisibleLine(0), _parser(cmd->Parser()), _dirty(false), _live(false), _loadedRows(0),
+    _headerStatusLen(0)
 {
 }
 
@@ -422,33 +547,34 @@ void ResultWin::Tab::RestoreView(const Tab& oldTab)
     intptr_t lastCurrent = 0;
     intptr_t lastFirst = 0;
 
-    const std::unordered_map<std::string, intptr_t>& newFileRes =
-            dynamic_cast<const TabParser*>(_parser.get())->getFileResults();
-
-    const std::unordered_map<std::string, intptr_t>& oldFileRes =
-            dynamic_cast<const TabParser*>(oldTab._parser.get())->getFileResults();
+    const ResultSet& newRes = dynamic_cast<const TabParser*>(_parser.get())->getResults();
+    const ResultSet& oldRes = dynamic_cast<const TabParser*>(oldTab._parser.get())->getResults();
 
-    for (const auto& oldFile : oldFileRes)
+    for (uint32_t oldFile = 0; oldFile < oldRes.FilesCount(); ++oldFile)
     {
-        if (oldTab._expandedLines.find(oldFile.second) == oldTab._expandedLines.end())
+        const intptr_t oldRow = oldRes.FileRow(oldFile);
+
+        if (oldTab._expandedLines.find(oldRow) == oldTab._expandedLines.end())
             continue;
 
-        const auto newFile = newFileRes.find(oldFile.first);
-        if (newFile == newFileRes.end())
+        const uint32_t newFile = newRes.FindFile(oldRes.FileName(oldFile));
+        if (newFile == ResultSet::cNone)
             continue;
 
-        _expandedLines.insert(newFile->second);
+        const intptr_t newRow = newRes.FileRow(newFile);
 
-        if (_currentLine >= newFile->second && lastCurrent < newFile->second)
+        _expandedLines.insert(newRow);
+
+        if (_currentLine >= newRow && lastCurrent < newRow)
         {
-            currentLineAdjustment = newFile->second - oldFile.second;
-            lastCurrent = newFile->second;
+            currentLineAdjustment = newRow - oldRow;
+            lastCurrent = newRow;
         }
 
-        if (_firstVisibleLine >= newFile->second && lastFirst < newFile->second)
+        if (_firstVisibleLine >= newRow && lastFirst < newRow)
         {
-            firstVisLineAdjustment = newFile->second - oldFile.second;
-            lastFirst = newFile->second;
+            firstVisLineAdjustment = newRow - oldRow;
+            lastFirst = newRow;
         }
     }
 
@@ -550,6 +676,12 @@ void ResultWin::show()
  */
 void ResultWin::show(const CmdPtr_t& cmd)
 {
+    const TabParser* parser = dynamic_cast<const TabParser*>(cmd->Parser().get());
+
+    // Results were shown while the search was running but the user has closed them meanwhile
+    if (parser && parser->isShownLive() && !cmd->IsCached() && findTab(cmd->Parser()) < 0)
+        return;
+
     Tab* tab = new Tab(cmd);
 
     bool isNewTab = false;
@@ -568,9 +700,15 @@ void ResultWin::show(const CmdPtr_t& cmd)
                 _activeTab->_firstVisibleLine = sendSci(SCI_GETFIRSTVISIBLELINE);
 
                 _activeTab = NULL;
-                hFocus = GetFocus();
+
+                if (!oldTab->_live)
+                    hFocus = GetFocus();
             }
 
+            // Search shown while running - complete it as if it is shown for the first time
+            if (oldTab->_live)
+                isNewTab = true;
+
             tab->RestoreView(*oldTab);
 
             delete oldTab;
@@ -580,21 +718,14 @@ void ResultWin::show(const CmdPtr_t& cmd)
 
     if (i == 0) // search is completely new - add new tab or visit single result
     {
-        if (visitSingleResult(tab))
+        // Result cut short by a limit is always shown so the user can get the rest
+        if (!cmd->IsPartial() && !cmd->IsTruncated() && visitSingleResult(tab))
         {
             delete tab;
             return;
         }
 
-        TCHAR buf[64];
-        _sntprintf_s(buf, _countof(buf), _TRUNCATE, _T("%s \"%s\""), cmd->Name(), cmd->Tag().C_str());
-
-        TCITEM tci  = {0};
-        tci.mask    = TCIF_TEXT | TCIF_PARAM;
-        tci.pszText = buf;
-        tci.lParam  = (LPARAM)tab;
-
-        i = TabCtrl_InsertItem(_hTab, TabCtrl_GetItemCount(_hTab), &tci);
+        i = insertTab(tab, cmd);
         if (i == -1)
         {
             delete tab;
@@ -641,6 +772,63 @@ void ResultWin::show(const CmdPtr_t& cmd)
 }
 
 
+/**
+ *  \brief  Shows the results of a still running search as they come
+ */
+void ResultWin::progress(const CmdPtr_t& cmd)
+{
+    TabParser* parser = dynamic_cast<TabParser*>(cmd->Parser().get());
+    if (!parser)
+        return;
+
+    Tab* tab;
+
+    int i = findTab(cmd->Parser());
+    if (i < 0)
+    {
+        // Live results tab closed by the user or just single result so far that might be visited directly
+        if (parser->isShownLive() || parser->getHitsCount() < 2)
+            return;
+
+        tab = new Tab(cmd);
+
+        // Keep the old results of the same search until the new ones are complete
+        for (i = TabCtrl_GetItemCount(_hTab); i; --i)
+        {
+            Tab* oldTab = getTab(i - 1);
+
+            if (oldTab && (*tab == *oldTab))
+            {
+                delete tab;
+                return;
+            }
+        }
+
+        i = insertTab(tab, cmd);
+        if (i == -1)
+        {
+            delete tab;
+            return;
+        }
+
+        tab->_live = true;
+        parser->setShownLive();
+
+        TabCtrl_SetCurSel(_hTab, i);
+        loadTab(tab);
+
+        showWindow(GetFocus());
+    }
+    else
+    {
+        tab = getTab(i);
+    }
+
+    if (tab == _activeTab)
+        appendLiveResults(tab);
+}
+
+
 /**
  *  \brief
  */
@@ -662,31 +850,7 @@ void ResultWin::close(const CmdPtr_t& cmd)
             ((cmdId == FIND_SYMBOL) && ((oldTab->_cmdId == FIND_DEFINITION) || (oldTab->_cmdId == FIND_REFERENCE)))) &&
             (projectPath == oldTab->_projectPath) && (search == oldTab->_search)) // same search tab already present?
         {
-            --i;
-
-            if (_activeTab == oldTab) // is this the currently active tab?
-                _activeTab = NULL;
-            delete oldTab;
-
-            TabCtrl_DeleteItem(_hTab, i);
-
-            if (--count)
-            {
-                i = i ? i - 1 : 0;
-                Tab* tab = getTab(i);
-                TabCtrl_SetCurSel(_hTab, i);
-                if (tab)
-                    loadTab(tab);
-            }
-            else
-            {
-                sendSci(SCI_SETREADONLY, 0);
-                sendSci(SCI_CLEARALL);
-                sendSci(SCI_SETREADONLY, 1);
-
-                hideWindow();
-            }
-
+            deleteTab(i - 1);
             return;
         }
     }
@@ -694,9 +858,23 @@ void ResultWin::close(const CmdPtr_t& cmd)
 
 
 /**
- *  \brief
+ *  \brief  Removes the results shown while the search was running if it didn't complete successfully
  */
-void ResultWin::reRunCmd()
+void ResultWin::abort(const CmdPtr_t& cmd)
+{
+    const int i = findTab(cmd->Parser());
+
+    if (i >= 0 && getTab(i)->_live)
+        deleteTab(i);
+}
+
+
+/**
+ *  \brief  Re-runs the active tab search keeping its results limit. On load more the limit is raised
+ *          with another portion of results or, if the search has been stopped on its time limit,
+ *          it is run with no time limit.
+ */
+void ResultWin::reRunCmd(bool loadMore)
 {
     if (!_activeTab)
         return;
@@ -705,10 +883,20 @@ void ResultWin::reRunCmd()
     if (!db)
         return;
 
+    size_t maxHits = _activeTab->_maxHits;
+    if (loadMore && !_activeTab->_partial)
+    {
+        const size_t step = CmdEngine::MaxHits(_activeTab->_cmdId);
+        maxHits = step ? maxHits + step : 0;
+    }
+
     ParserPtr_t parser(new ResultWin::TabParser);
     CmdPtr_t cmd(new Cmd(_activeTab->_cmdId, db, parser, NULL, _activeTab->_ignoreCase, _activeTab->_regExp));
 
     cmd->Tag(CText(_activeTab->_search.C_str()));
+    cmd->MaxHits(maxHits);
+    if (loadMore && _activeTab->_partial)
+        cmd->Deadline(INFINITE);
     CmdEngine::Run(cmd, showResultCB);
 
     _activeTab->_dirty = false;
@@ -1171,6 +1359,73 @@ ResultWin::Tab* ResultWin::getTab(int i)
 }
 
 
+/**
+ *  \brief
+ */
+int ResultWin::findTab(const ParserPtr_t& parser)
+{
+    for (int i = TabCtrl_GetItemCount(_hTab); i; --i)
+    {
+        Tab* tab = getTab(i - 1);
+
+        if (tab && tab->_parser == parser)
+            return i - 1;
+    }
+
+    return -1;
+}
+
+
+/**
+ *  \brief
+ */
+int ResultWin::insertTab(ResultWin::Tab* tab, const CmdPtr_t& cmd)
+{
+    TCHAR buf[64];
+    _sntprintf_s(buf, _countof(buf), _TRUNCATE, _T("%s \"%s\""), cmd->Name(), cmd->Tag().C_str());
+
+    TCITEM tci  = {0};
+    tci.mask    = TCIF_TEXT | TCIF_PARAM;
+    tci.pszText = buf;
+    tci.lParam  = (LPARAM)tab;
+
+    return TabCtrl_InsertItem(_hTab, TabCtrl_GetItemCount(_hTab), &tci);
+}
+
+
+/**
+ *  \brief
+ */
+void ResultWin::deleteTab(int i)
+{
+    Tab* tab = getTab(i);
+
+    if (_activeTab == tab) // is this the currently active tab?
+        _activeTab = NULL;
+    delete tab;
+
+    TabCtrl_DeleteItem(_hTab, i);
+
+    int count = TabCtrl_GetItemCount(_hTab);
+    if (count)
+    {
+        i = i ? i - 1 : 0;
+        tab = getTab(i);
+        TabCtrl_SetCurSel(_hTab, i);
+        if (tab)
+            loadTab(tab);
+    }
+    else
+    {
+        sendSci(SCI_SETREADONLY, 0);
+        sendSci(SCI_CLEARALL);
+        sendSci(SCI_SETREADONLY, 1);
+
+        hideWindow();
+    }
+}
+
+
 /**
  *  \brief
  */
@@ -1190,7 +1445,32 @@ void ResultWin::loadTab(ResultWin::Tab* tab, bool firstTimeLoad)
 
     _activeTab = tab;
 
-    sendSci(SCI_SETTEXT, 0, reinterpret_cast<LPARAM>(tab->_parser->GetText().C_str()));
+    const TabParser* parser = dynamic_cast<TabParser*>(tab->_parser.get());
+
+    // Search still running - its results so far will be appended on next progress update
+    if (tab->_live)
+    {
+        tab->_loadedRows = 0;
+        tab->_headerStatusLen = 0;
+
+        sendSci(SCI_SETREADONLY, 1);
+        return;
+    }
+
+    tab->_headerStatusLen = parser->getHeaderStatusLen();
+
+    // Only a page of the results text is composed at a time - the view keeps its own copy anyway
+    const intptr_t rowsCount = parser->getResults().RowsCount();
+    intptr_t row = 0;
+
+    do
+    {
+        std::string text;
+        row = parser->getText(text, row, cPageRows);
+        sendSci(SCI_APPENDTEXT, text.size(), reinterpret_cast<LPARAM>(text.c_str()));
+    }
+    while (row < rowsCount);
+
     sendSci(SCI_SETREADONLY, 1);
 
     sendSci(SCI_GOTOLINE, tab->_currentLine);
@@ -1202,14 +1482,45 @@ void ResultWin::loadTab(ResultWin::Tab* tab, bool firstTimeLoad)
     }
     else if (firstTimeLoad && tab->_cmdId != FIND_FILE)
     {
-        const TabParser* parser = dynamic_cast<TabParser*>(tab->_parser.get());
-
         if (parser->getFilesCount() == 1)
             foldAll(SC_FOLDACTION_EXPAND);
     }
 }
 
 
+/**
+ *  \brief  Appends the newly parsed results of a running search and updates the header results counter
+ */
+void ResultWin::appendLiveResults(ResultWin::Tab* tab)
+{
+    const TabParser* parser = dynamic_cast<TabParser*>(tab->_parser.get());
+    const std::string status = parser->getStatus();
+
+    sendSci(SCI_SETREADONLY, 0);
+
+    const intptr_t rowsCount = parser->getResults().RowsCount();
+
+    // Header is composed with the current status on the first append
+    if (tab->_loadedRows == 0)
+        tab->_headerStatusLen = (int)status.size();
+
+    while (tab->_loadedRows < rowsCount)
+    {
+        std::string text;
+        tab->_loadedRows = parser->getText(text, tab->_loadedRows, cPageRows);
+        sendSci(SCI_APPENDTEXT, text.size(), reinterpret_cast<LPARAM>(text.c_str()));
+    }
+
+    const intptr_t countsPos = (intptr_t)parser->getCountsPos();
+
+    sendSci(SCI_SETTARGETRANGE, countsPos, countsPos + tab->_headerStatusLen);
+    sendSci(SCI_REPLACETARGET, status.size(), reinterpret_cast<LPARAM>(status.c_str()));
+    tab->_headerStatusLen = (int)status.size();
+
+    sendSci(SCI_SETREADONLY, 1);
+}
+
+
 /**
  *  \brief
  */
@@ -1222,22 +1533,15 @@ bool ResultWin::visitSingleResult(ResultWin::Tab* tab)
 
     releaseKeys();
 
-    intptr_t line = -1;
+    const ResultSet& results = parser->getResults();
 
-    if (tab->_cmdId != FIND_FILE)
-    {
-        const std::string results(parser->GetText().C_str());
+    intptr_t line = -1;
 
-        const size_t pos = results.rfind("\t\tline ");
-        if (pos != std::string::npos)
-        {
-            const std::string lineNum = results.substr(pos + 7);
-            line = (intptr_t)std::stoll(lineNum) - 1;
-        }
-    }
+    if (tab->_cmdId != FIND_FILE && results.HitsCount())
+        line = (intptr_t)results.HitLine(0) - 1;
 
     CPath file = tab->_projectPath.C_str();
-    file += parser->getFirstFileResult().c_str();
+    file += results.FileName(0).c_str();
 
     INpp& npp = INpp::Get();
     if (!file.FileExists())
@@ -1272,6 +1576,20 @@ bool ResultWin::visitSingleResult(ResultWin::Tab* tab)
 }
 
 
+/**
+ *  \brief  Checks if the line is the load more results entry
+ */
+bool ResultWin::isMoreLine(intptr_t lineNum)
+{
+    if (!_activeTab || _activeTab->_live)
+        return false;
+
+    const TabParser* parser = dynamic_cast<const TabParser*>(_activeTab->_parser.get());
+
+    return (parser->getMoreLine() && parser->getMoreLine() == lineNum);
+}
+
+
 /**
  *  \brief
  */
@@ -1279,49 +1597,39 @@ bool ResultWin::openItem(intptr_t lineNum, unsigned matchNum)
 {
     releaseKeys();
 
-    intptr_t lineLen = sendSci(SCI_GETCURRENTPOS, 0, 0);
-    sendSci(SCI_SETSEL, lineLen, lineLen);
+    const intptr_t pos = sendSci(SCI_GETCURRENTPOS, 0, 0);
+    sendSci(SCI_SETSEL, pos, pos);
 
-    lineLen = sendSci(SCI_LINELENGTH, lineNum);
-    if (lineLen <= 0)
-        return false;
-
-    std::vector<char> lineTxt;
-    lineTxt.resize(lineLen + 1, 0);
-
-    sendSci(SCI_GETLINE, lineNum, reinterpret_cast<LPARAM>(lineTxt.data()));
+    const TabParser* parser = dynamic_cast<const TabParser*>(_activeTab->_parser.get());
 
     intptr_t line = 0;
-    intptr_t i;
+    CPath file;
 
-    if (_activeTab->_cmdId != FIND_FILE)
     {
-        for (i = 7; i <= lineLen && lineTxt[i] != ':'; ++i);
-        lineTxt[i] = 0;
-        line = (intptr_t)atoll(&lineTxt[7]) - 1;
+        AUTOLOCK(parser->getLock());
 
-        lineNum = sendSci(SCI_GETFOLDPARENT, lineNum);
-        if (lineNum == -1)
-            return false;
+        const ResultSet& results = parser->getResults();
 
-        lineLen = sendSci(SCI_LINELENGTH, lineNum);
-        if (lineLen <= 0)
+        ResultSet::Row row;
+        if (!results.GetRow(lineNum, row))
             return false;
 
-        lineTxt.resize(lineLen + 1, 0);
-        sendSci(SCI_GETLINE, lineNum, reinterpret_cast<LPARAM>(lineTxt.data()));
-    }
+        if (_activeTab->_cmdId != FIND_FILE)
+        {
+            if (row.hit == ResultSet::cNone)
+                return false;
 
-    for (i = 1; (i <= lineLen) && (lineTxt[i] != '\r') && (lineTxt[i] != '\n'); ++i);
-    lineTxt[i] = 0;
+            line = (intptr_t)results.HitLine(row.hit) - 1;
+        }
 
-    CPath file;
+        const std::string& fileName = results.FileName(row.file);
 
-    // Path is not absolute (does not start with drive letter)
-    if ((lineLen < 5) || (lineTxt[2] != ':'))
-        file = _activeTab->_projectPath.C_str();
+        // Path is not absolute (does not start with drive letter)
+        if ((fileName.size() < 3) || (fileName[1] != ':'))
+            file = _activeTab->_projectPath.C_str();
 
-    file += &lineTxt[1];
+        file += fileName.c_str();
+    }
 
     INpp& npp = INpp::Get();
     if (!file.FileExists())
@@ -1451,6 +1759,13 @@ void ResultWin::onStyleNeeded(SCNotification* notify)
     intptr_t lineNum = sendSci(SCI_LINEFROMPOSITION, sendSci(SCI_GETENDSTYLED));
     const intptr_t endStylingPos = notify->position;
 
+    const TabParser* parser = dynamic_cast<const TabParser*>(_activeTab->_parser.get());
+
+    AUTOLOCK(parser->getLock());
+
+    const ResultSet& results = parser->getResults();
+    const intptr_t moreLine = _activeTab->_live ? 0 : parser->getMoreLine();
+
     for (intptr_t startPos = sendSci(SCI_POSITIONFROMLINE, lineNum); endStylingPos > startPos;
             startPos = sendSci(SCI_POSITIONFROMLINE, ++lineNum))
     {
@@ -1462,19 +1777,31 @@ void ResultWin::onStyleNeeded(SCNotification* notify)
 
         sendSci(SCI_STARTSTYLING, startPos, 0xFF);
 
-        if ((char)sendSci(SCI_GETCHARAT, startPos) != '\t')
+        if (moreLine && lineNum == moreLine)
+        {
+            sendSci(SCI_SETSTYLING, lineLen, SCE_GTAGS_LINE_NUM);
+            sendSci(SCI_SETFOLDLEVEL, lineNum, FILE_HEADER_LVL);
+            continue;
+        }
+
+        ResultSet::Row row;
+
+        if (lineNum == 0)
         {
             size_t pathLen = _activeTab->_projectPath.Len();
-            const TabParser* parser = dynamic_cast<TabParser*>(_activeTab->_parser.get());
 
             // 2 * '"' + LF + CR = 4 so length to style is modified with -4 and +1 (as it is length)
-            sendSci(SCI_SETSTYLING, lineLen - pathLen - parser->getHeaderStatusLen() - 3, SCE_GTAGS_HEADER);
+            sendSci(SCI_SETSTYLING, lineLen - pathLen - _activeTab->_headerStatusLen - 3, SCE_GTAGS_HEADER);
             sendSci(SCI_SETSTYLING, pathLen + 2, SCE_GTAGS_PROJECT_PATH);
-            sendSci(SCI_SETSTYLING, parser->getHeaderStatusLen(), SCE_GTAGS_HEADER);
+            sendSci(SCI_SETSTYLING, _activeTab->_headerStatusLen, SCE_GTAGS_HEADER);
+        }
+        else if (!results.GetRow(lineNum, row))
+        {
+            sendSci(SCI_SETSTYLING, lineLen, STYLE_DEFAULT);
         }
         else
         {
-            if ((char)sendSci(SCI_GETCHARAT, startPos + 1) != '\t')
+            if (row.hit == ResultSet::cNone)
             {
                 if (_activeTab->_cmdId == FIND_FILE)
                 {
@@ -1517,9 +1844,7 @@ void ResultWin::onStyleNeeded(SCNotification* notify)
             }
             else
             {
-                // "\t\tline: Num" - 'N' is at position 8
-                intptr_t previewPos = startPos + 8;
-                for (; (char)sendSci(SCI_GETCHARAT, previewPos) != '\t'; ++previewPos);
+                intptr_t previewPos = startPos + ResultSet::PreviewPos(results.HitLine(row.hit));
 
                 intptr_t findBegin = previewPos;
                 intptr_t findEnd = endPos;
@@ -1570,7 +1895,7 @@ void ResultWin::onNewPosition()
     if (pos == sendSci(SCI_POSITIONAFTER, pos)) // end of document
     {
         const intptr_t foldLine = sendSci(SCI_GETFOLDPARENT, sendSci(SCI_LINEFROMPOSITION, pos));
-        if (!sendSci(SCI_GETFOLDEXPANDED, foldLine))
+        if (foldLine >= 0 && !sendSci(SCI_GETFOLDEXPANDED, foldLine))
             sendSci(SCI_GOTOLINE, foldLine);
     }
 }
@@ -1586,11 +1911,24 @@ void ResultWin::onHotspotClick(SCNotification* notify)
 
     if (_activeTab->_cmdId != FIND_FILE)
     {
+        const TabParser* parser = dynamic_cast<const TabParser*>(_activeTab->_parser.get());
+
+        uint32_t line;
+        {
+            AUTOLOCK(parser->getLock());
+
+            const ResultSet& results = parser->getResults();
+
+            ResultSet::Row row;
+            if (!results.GetRow(lineNum, row) || row.hit == ResultSet::cNone)
+                return;
+
+            line = results.HitLine(row.hit);
+        }
+
         const intptr_t endLine = sendSci(SCI_GETLINEENDPOSITION, lineNum);
 
-        // "\t\tline: Num" - 'N' is at position 8
-        intptr_t findBegin = sendSci(SCI_POSITIONFROMLINE, lineNum) + 8;
-        for (; (char)sendSci(SCI_GETCHARAT, findBegin) != '\t'; ++findBegin);
+        intptr_t findBegin = sendSci(SCI_POSITIONFROMLINE, lineNum) + ResultSet::PreviewPos(line);
 
         const bool wholeWord = (_activeTab->_cmdId != GREP && _activeTab->_cmdId != GREP_TEXT);
 
@@ -1621,7 +1959,7 @@ void ResultWin::onDoubleClick(intptr_t pos)
         {
             lineNum = sendSci(SCI_LINEFROMPOSITION, pos);
             const intptr_t foldLine = sendSci(SCI_GETFOLDPARENT, lineNum);
-            if (!sendSci(SCI_GETFOLDEXPANDED, foldLine))
+            if (foldLine >= 0 && !sendSci(SCI_GETFOLDEXPANDED, foldLine))
             {
                 lineNum = foldLine;
                 pos = sendSci(SCI_POSITIONFROMLINE, lineNum);
@@ -1640,7 +1978,9 @@ void ResultWin::onDoubleClick(intptr_t pos)
     }
     else if (lineNum > 0)
     {
-        if (sendSci(SCI_GETFOLDLEVEL, lineNum) & SC_FOLDLEVELHEADERFLAG)
+        if (isMoreLine(lineNum))
+            reRunCmd(true);
+        else if (sendSci(SCI_GETFOLDLEVEL, lineNum) & SC_FOLDLEVELHEADERFLAG)
             toggleFolding(lineNum);
         else
             openItem(lineNum);
@@ -1801,7 +2141,7 @@ bool ResultWin::onKeyPress(WORD keyCode, bool alt)
             {
                 lineNum = sendSci(SCI_GETLINECOUNT) - 1;
                 const intptr_t foldLine = sendSci(SCI_GETFOLDPARENT, lineNum);
-                if (!sendSci(SCI_GETFOLDEXPANDED, foldLine))
+                if (foldLine >= 0 && !sendSci(SCI_GETFOLDEXPANDED, foldLine))
                     lineNum = foldLine;
             }
 
@@ -2214,14 +2554,16 @@ LRESULT APIENTRY ResultWin::wndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM
         // Below are WM_USER messages for DLL threads synchronization
 
         case WM_RUN_CMD_CALLBACK:
-        {
-            CompletionCB    complCB = reinterpret_cast<CompletionCB>(wParam);
-            CmdPtr_t        cmd(*(reinterpret_cast<CmdPtr_t*>(lParam)));
+            CmdEngine::DeliverCompletions();
+        return 0;
 
-            ReplyMessage(0);
+        case WM_RUN_CMD_PROGRESS:
+        {
+            const CmdPtr_t* cmd = reinterpret_cast<const CmdPtr_t*>(lParam);
 
-            if (complCB && cmd)
-                complCB(cmd);
+            // No ReplyMessage() here - the command thread waits while its results are accessed
+            if (cmd && *cmd)
+                RW->progress(*cmd);
         }
         return 0;
 
@@ -2248,6 +2590,15 @@ LRESULT APIENTRY ResultWin::wndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM
             }
         }
         return 0;
+
+        case WM_REPLAY_DONE:
+        {
+            std::unique_ptr<CText> report(reinterpret_cast<CText*>(lParam));
+
+            if (report)
+                GTags::OnReplayDone(*report, wParam != 0);
+        }
+        return 0;
     }
 
     return DefWindowProc(hWnd, uMsg, wParam, lParam);
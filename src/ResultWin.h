@@ -34,6 +34,10 @@
 #include "NppAPI/Scintilla.h"
 #include "Common.h"
 #include "Cmd.h"
+#include "StrUniquenessChecker.h"
+#include "Scanner.h"
+#include "ResultSet.h"
+#include "AutoLock.h"
 
 
 namespace GTags
@@ -53,39 +57,64 @@ public:
     class TabParser : public ResultParser
     {
     public:
-        TabParser() : _filesCount(0), _hits(0), _headerStatusLen(0) {}
+        TabParser() : _cmdId(FIND_FILE), _filesCount(0), _hits(0), _headerStatusLen(0), _moreLine(0),
+            _previousFileFiltered(false), _filterReoccurring(false), _shownLive(false) {}
         virtual ~TabParser() {}
 
         virtual intptr_t Parse(const CmdPtr_t&);
 
+        virtual bool IsStreaming() const { return true; }
+        virtual void Begin(const CmdPtr_t&);
+        virtual bool ParseLine(const CmdPtr_t&, char* pLine, size_t len);
+        virtual intptr_t End(const CmdPtr_t&);
+
+        virtual ParserPtr_t Clone() const;
+        virtual size_t MemSize() const;
+
         inline intptr_t getFilesCount() const { return _filesCount; }
         inline intptr_t getHitsCount() const { return _hits ? _hits : _filesCount; }
         inline int getHeaderStatusLen() const { return _headerStatusLen; }
+        inline size_t getCountsPos() const { return _header.Len(); }
+        inline intptr_t getMoreLine() const { return _moreLine; }
+        std::string getStatus() const;
 
-        inline void addResultFile(const char* pFile, size_t len, intptr_t line)
-        {
-            _fileResults.emplace(std::string(pFile, len), line);
-        }
+        intptr_t getText(std::string& text, intptr_t fromRow = 0, intptr_t maxRows = 0) const;
+
+        inline bool isShownLive() const { return _shownLive; }
+        inline void setShownLive() { _shownLive = true; }
 
         inline bool isFileInResults(const std::string& file) const
         {
-            return (_fileResults.find(file) != _fileResults.end());
+            return (_results.FindFile(file) != ResultSet::cNone);
         }
 
-        inline const std::string& getFirstFileResult() const { return _fileResults.begin()->first; }
-        inline const std::unordered_map<std::string, intptr_t>& getFileResults() const { return _fileResults; }
+        // Results of a running search are accessed under this lock
+        inline Mutex& getLock() const { return _lock; }
+        inline const ResultSet& getResults() const { return _results; }
 
     private:
         static bool filterEntry(const DbConfig& cfg, const char* pEntry, size_t len);
 
-        intptr_t parseCmd(const CmdPtr_t&);
-        intptr_t parseFindFile(const CmdPtr_t&);
+        bool parseCmdLine(const DbConfig& cfg, char* pLine, size_t len, const Scanner::Line& line);
+        bool parseFindFileLine(const DbConfig& cfg, const char* pLine, size_t len);
 
+        CmdId_t     _cmdId;
         intptr_t    _filesCount;
         intptr_t    _hits;
         int         _headerStatusLen;
 
-        std::unordered_map<std::string, intptr_t> _fileResults;
+        CTextA      _header;
+        CTextA      _moreText;
+        intptr_t    _moreLine;
+        std::string _previousFile;
+        bool        _previousFileFiltered;
+        bool        _filterReoccurring;
+        bool        _shownLive;
+
+        StrUniquenessChecker<char> _strChecker;
+
+        ResultSet       _results;
+        mutable Mutex   _lock;
     };
 
 
@@ -110,6 +139,12 @@ public:
             RW->close(cmd);
     }
 
+    static void Abort(const CmdPtr_t& cmd)
+    {
+        if (RW)
+            RW->abort(cmd);
+    }
+
     static void ApplyStyle()
     {
         if (RW)
@@ -158,6 +193,8 @@ private:
         const CmdId_t   _cmdId;
         const bool      _regExp;
         const bool      _ignoreCase;
+        const size_t    _maxHits;
+        const bool      _partial;
         CTextA          _projectPath;
         CTextA          _search;
         intptr_t        _currentLine;
@@ -165,6 +202,9 @@ private:
         ParserPtr_t     _parser;
 
         bool            _dirty;
+        bool            _live;
+        intptr_t        _loadedRows;
+        int             _headerStatusLen;
 
         inline void SetFolded(intptr_t lineNum);
         inline void SetAllFolded();
@@ -188,6 +228,8 @@ private:
     static const unsigned   cSearchFontSize;
     static const int        cSearchWidth;
 
+    static const intptr_t   cPageRows;
+
     static LRESULT CALLBACK keyHookProc(int code, WPARAM wParam, LPARAM lParam);
     static LRESULT APIENTRY wndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
     static LRESULT APIENTRY searchWndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
@@ -200,8 +242,10 @@ private:
 
     void show();
     void show(const CmdPtr_t& cmd);
+    void progress(const CmdPtr_t& cmd);
     void close(const CmdPtr_t& cmd);
-    void reRunCmd();
+    void abort(const CmdPtr_t& cmd);
+    void reRunCmd(bool loadMore = false);
     void applyStyle();
     void notifyDBUpdate(const CmdPtr_t& cmd);
 
@@ -228,8 +272,13 @@ private:
     }
 
     Tab* getTab(int i = -1);
+    int findTab(const ParserPtr_t& parser);
+    int insertTab(Tab* tab, const CmdPtr_t& cmd);
+    void deleteTab(int i);
     void loadTab(Tab* tab, bool firstTimeLoad = false);
+    void appendLiveResults(Tab* tab);
     bool visitSingleResult(Tab* tab);
+    bool isMoreLine(intptr_t lineNum);
     bool openItem(intptr_t lineNum, unsigned matchNum = 1);
 
     bool findString(const char* str, intptr_t* startPos, intptr_t* endPos,
@@ -0,0 +1,240 @@
+/**
+ *  \file
+ *  \brief  Vectorized output lines and fields scanner
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2022 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#include "Scanner.h"
+
+
+// GCC needs the instruction set enabled per function as the rest of the code is built without it
+#if defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+
+namespace
+{
+
+/**
+ *  \brief
+ */
+inline unsigned lowestBit(unsigned mask)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (unsigned)idx;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+
+/**
+ *  \brief
+ */
+void cpuid(unsigned leaf, unsigned regs[4])
+{
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, (int)leaf, 0);
+
+    for (int i = 0; i < 4; ++i)
+        regs[i] = (unsigned)r[i];
+#else
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+
+/**
+ *  \brief  Returns the CPU register states enabled by the OS
+ */
+unsigned long long xgetbv()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned eax, edx;
+    __asm__ __volatile__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+} // anonymous namespace
+
+
+namespace GTags
+{
+
+Scanner::ScanFunc_t const Scanner::ScanImpl = Scanner::selectImpl();
+
+
+/**
+ *  \brief  Picks the widest vector instructions the CPU and the OS support
+ */
+Scanner::ScanFunc_t Scanner::selectImpl()
+{
+    unsigned regs[4];
+
+    cpuid(0, regs);
+    const unsigned maxLeaf = regs[0];
+    if (maxLeaf < 1)
+        return scan;
+
+    cpuid(1, regs);
+    const bool sse2     = ((regs[3] & (1u << 26)) != 0);
+    const bool osxsave  = ((regs[2] & (1u << 27)) != 0);
+    const bool avx      = ((regs[2] & (1u << 28)) != 0);
+
+    // AVX registers state (XMM and YMM) has to be saved by the OS
+    if (maxLeaf >= 7 && osxsave && avx && (xgetbv() & 6) == 6)
+    {
+        cpuid(7, regs);
+        if (regs[1] & (1u << 5))
+            return scanAvx2;
+    }
+
+    return sse2 ? scanSse2 : scan;
+}
+
+
+/**
+ *  \brief
+ */
+void Scanner::scan(const char* pSrc, const char* pEnd, char sep, Line& line)
+{
+    line.sepsCount = 0;
+    scanTail(pSrc, pEnd, sep, line);
+}
+
+
+/**
+ *  \brief  Checks 16 bytes at a time for end of line and separators
+ */
+TARGET_SSE2 void Scanner::scanSse2(const char* pSrc, const char* pEnd, char sep, Line& line)
+{
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i sp = _mm_set1_epi8(sep);
+
+    line.sepsCount = 0;
+
+    for (; pEnd - pSrc >= 16; pSrc += 16)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+
+        const unsigned eolMask = (unsigned)_mm_movemask_epi8(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, nl), _mm_cmpeq_epi8(chunk, cr)));
+
+        if (line.sepsCount < cMaxSeps)
+        {
+            unsigned sepMask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, sp));
+
+            // Only the separators before the end of line count
+            if (eolMask)
+                sepMask &= (eolMask & (0u - eolMask)) - 1;
+
+            for (; sepMask && line.sepsCount < cMaxSeps; sepMask &= sepMask - 1)
+                line.pSeps[line.sepsCount++] = pSrc + lowestBit(sepMask);
+        }
+
+        if (eolMask)
+        {
+            line.pEol = pSrc + lowestBit(eolMask);
+            return;
+        }
+    }
+
+    scanTail(pSrc, pEnd, sep, line);
+}
+
+
+/**
+ *  \brief  Checks 32 bytes at a time for end of line and separators
+ */
+TARGET_AVX2 void Scanner::scanAvx2(const char* pSrc, const char* pEnd, char sep, Line& line)
+{
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i sp = _mm256_set1_epi8(sep);
+
+    line.sepsCount = 0;
+
+    for (; pEnd - pSrc >= 32; pSrc += 32)
+    {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc));
+
+        const unsigned eolMask = (unsigned)_mm256_movemask_epi8(
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, nl), _mm256_cmpeq_epi8(chunk, cr)));
+
+        if (line.sepsCount < cMaxSeps)
+        {
+            unsigned sepMask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, sp));
+
+            if (eolMask)
+                sepMask &= (eolMask & (0u - eolMask)) - 1;
+
+            for (; sepMask && line.sepsCount < cMaxSeps; sepMask &= sepMask - 1)
+                line.pSeps[line.sepsCount++] = pSrc + lowestBit(sepMask);
+        }
+
+        if (eolMask)
+        {
+            line.pEol = pSrc + lowestBit(eolMask);
+            return;
+        }
+    }
+
+    scanTail(pSrc, pEnd, sep, line);
+}
+
+
+/**
+ *  \brief  Scans the last bytes that don't fill a vector. The separators already found are kept.
+ */
+void Scanner::scanTail(const char* pSrc, const char* pEnd, char sep, Line& line)
+{
+    for (; pSrc < pEnd; ++pSrc)
+    {
+        if (*pSrc == '\n' || *pSrc == '\r')
+            break;
+
+        if (*pSrc == sep && line.sepsCount < cMaxSeps)
+            line.pSeps[line.sepsCount++] = pSrc;
+    }
+
+    line.pEol = pSrc;
+}
+
+} // namespace GTags
@@ -0,0 +1,70 @@
+/**
+ *  \file
+ *  \brief  Vectorized output lines and fields scanner
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2022 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#pragma once
+
+
+#include <cstddef>
+
+
+namespace GTags
+{
+
+/**
+ *  \class  Scanner
+ *  \brief  Finds the end of line and the field separators of the commands output in a single pass.
+ *          Uses SSE2 or AVX2 if the CPU supports them.
+ */
+class Scanner
+{
+public:
+    static const unsigned cMaxSeps = 3;
+
+    struct Line
+    {
+        const char* pEol;               // First '\n' or '\r' or the scanned range end
+        unsigned    sepsCount;
+        const char* pSeps[cMaxSeps];    // Positions of the first separators before pEol
+    };
+
+    static inline void ScanLine(const char* pSrc, const char* pEnd, char sep, Line& line)
+    {
+        ScanImpl(pSrc, pEnd, sep, line);
+    }
+
+private:
+    typedef void (*ScanFunc_t)(const char* pSrc, const char* pEnd, char sep, Line& line);
+
+    static ScanFunc_t const ScanImpl;
+
+    static ScanFunc_t selectImpl();
+
+    static void scan(const char* pSrc, const char* pEnd, char sep, Line& line);
+    static void scanSse2(const char* pSrc, const char* pEnd, char sep, Line& line);
+    static void scanAvx2(const char* pSrc, const char* pEnd, char sep, Line& line);
+    static void scanTail(const char* pSrc, const char* pEnd, char sep, Line& line);
+};
+
+} // namespace GTags
@@ -243,8 +243,7 @@ void SearchWin::startCompletion()
 
     CmdId_t cmplId;
     TCHAR tag[cComplAfter + 2];
-    CompletionCB complCB;
-    ParserPtr_t parser;
+    ParserPtr_t parser(new LineParser);
 
     if (_cmd->Id() == FIND_FILE)
     {
@@ -253,9 +252,6 @@ void SearchWin::startCompletion()
         tag[0] = _T('/');
         ComboBox_GetText(_hSearch, tag + 1, _countof(tag) - 1);
         tag[cComplAfter + 1] = 0;
-
-        complCB = endCompletion;
-        parser.reset(new LineParser);
     }
     else
     {
@@ -267,8 +263,6 @@ void SearchWin::startCompletion()
         for (int i = 0; tag[i] != 0; ++i)
             if (tag[i] == _T(' ') || tag[i] == _T('\t'))
                 return;
-
-        complCB = halfComplete;
     }
 
     CmdPtr_t cmpl(new Cmd(cmplId, _cmd->Db(), parser, tag, (Button_GetCheck(_hIC) == BST_CHECKED), false));
@@ -278,38 +272,10 @@ void SearchWin::startCompletion()
 
     _completionStarted = true;
 
-    CmdEngine::Run(cmpl, complCB);
-}
-
-
-/**
- *  \brief
- */
-void SearchWin::halfComplete(const CmdPtr_t& cmpl)
-{
-    if (SW == NULL)
-        return;
-
-    if (ComboBox_GetTextLength(SW->_hSearch) < cComplAfter)
-    {
-        SW->_completionStarted = false;
-        return;
-    }
-
-    if (cmpl->Status() == OK)
-    {
-        cmpl->Id(AUTOCOMPLETE_SYMBOL);
-
-        ParserPtr_t parser(new LineParser);
-        cmpl->Parser(parser);
-
-        CmdEngine::Run(cmpl, endCompletion);
-    }
+    if (cmplId == AUTOCOMPLETE)
+        CmdEngine::RunJoined(cmpl, AUTOCOMPLETE_SYMBOL, endCompletion);
     else
-    {
-        SW->_completionStarted = false;
-        SW->_completionDone = true;
-    }
+        CmdEngine::Run(cmpl, endCompletion);
 }
 
 
@@ -326,10 +292,11 @@ void SearchWin::endCompletion(const CmdPtr_t& cmpl)
     if (ComboBox_GetTextLength(SW->_hSearch) < cComplAfter)
         return;
 
-    if (cmpl->Status() == OK && cmpl->Result())
+    if (cmpl->Status() == OK && cmpl->HasResult())
     {
         SW->_completion = cmpl->Parser();
         SW->filterComplList();
+        cmpl->Stamp(Cmd::SHOWN);
     }
 
     SW->_completionDone = true;
@@ -475,7 +442,7 @@ void SearchWin::onOK()
         _cmd->IgnoreCase(ic);
 
         _cancelled = false;
-        CmdEngine::Run(_cmd, _complCB);
+        RunSearch(_cmd, _complCB);
     }
 
     SendMessage(_hWnd, WM_CLOSE, 0, 0);
@@ -56,7 +56,6 @@ private:
     static LRESULT CALLBACK keyHookProc(int code, WPARAM wParam, LPARAM lParam);
     static LRESULT APIENTRY wndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
-    static void halfComplete(const CmdPtr_t&);
     static void endCompletion(const CmdPtr_t&);
 
     SearchWin(const CmdPtr_t& cmd, CompletionCB complCB) :
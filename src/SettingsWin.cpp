@@ -808,6 +808,15 @@ bool SettingsWin::saveTab(SettingsWin::Tab* tab)
 
     newSettings._re = GTagsSettings._re;
     newSettings._ic = GTagsSettings._ic;
+    newSettings._prioritize = GTagsSettings._prioritize;
+    newSettings._speculativeFind = GTagsSettings._speculativeFind;
+    newSettings._maxFileHits = GTagsSettings._maxFileHits;
+    newSettings._maxFindHits = GTagsSettings._maxFindHits;
+    newSettings._maxGrepHits = GTagsSettings._maxGrepHits;
+    newSettings._complDeadline = GTagsSettings._complDeadline;
+    newSettings._findDeadline = GTagsSettings._findDeadline;
+    newSettings._grepDeadline = GTagsSettings._grepDeadline;
+    newSettings._traceFile = GTagsSettings._traceFile;
 
     CPath cfgFile;
     INpp::Get().GetPluginsConfDir(cfgFile);
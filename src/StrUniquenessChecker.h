@@ -25,20 +25,22 @@
 #pragma once
 
 
-#include <string>
-#include <unordered_set>
-#include <functional>
+#include <cstdint>
+#include <cstring>
+#include <vector>
 
 
 /**
  *  \class  StrUniquenessChecker
- *  \brief
+ *  \brief  Open addressing set of the strings seen so far. Only the first occurrence of each string
+ *          is copied in the arena, the slots keep its hash, offset and length so the strings are
+ *          compared exactly without allocating on each check.
  */
 template<typename CharType>
 class StrUniquenessChecker
 {
 public:
-    StrUniquenessChecker() {}
+    StrUniquenessChecker() : _used(0) {}
     ~StrUniquenessChecker() {}
 
     bool IsUnique(const CharType* ptr)
@@ -46,15 +48,124 @@ public:
         if (!ptr)
             return false;
 
-        std::basic_string<CharType> str(ptr);
-        std::hash<std::basic_string<CharType>> hash;
+        size_t len = 0;
+        while (ptr[len])
+            ++len;
 
-        return _set.insert(hash(str)).second;
+        return IsUnique(ptr, len);
+    }
+
+    bool IsUnique(const CharType* ptr, size_t len)
+    {
+        if (!ptr)
+            return false;
+
+        // Keep the load factor below 1/2 so probing stays short
+        if ((_used + 1) * 2 > _slots.size())
+            grow();
+
+        const uint64_t h = hash(ptr, len);
+        const size_t mask = _slots.size() - 1;
+
+        for (size_t i = (size_t)h & mask;; i = (i + 1) & mask)
+        {
+            Slot& slot = _slots[i];
+
+            if (slot.offset == cEmpty)
+            {
+                slot.hash   = h;
+                slot.offset = _arena.size();
+                slot.len    = len;
+
+                _arena.insert(_arena.end(), ptr, ptr + len);
+                ++_used;
+
+                return true;
+            }
+
+            if (slot.hash == h && slot.len == len &&
+                    (len == 0 || !memcmp(&_arena[slot.offset], ptr, len * sizeof(CharType))))
+                return false;
+        }
+    }
+
+    // Frees the memory as well
+    void Clear()
+    {
+        std::vector<Slot>().swap(_slots);
+        std::vector<CharType>().swap(_arena);
+        _used = 0;
     }
 
 private:
+    static const size_t cEmpty = SIZE_MAX;
+    static const size_t cMinSlots = 256;
+
+    struct Slot
+    {
+        Slot() : hash(0), offset(cEmpty), len(0) {}
+
+        uint64_t    hash;
+        size_t      offset;
+        size_t      len;
+    };
+
     StrUniquenessChecker(const StrUniquenessChecker&) = delete;
     const StrUniquenessChecker& operator=(const StrUniquenessChecker&) = delete;
 
-    std::unordered_set<std::size_t> _set;
+    /**
+     *  \brief  Multiplicative hash over 8 bytes at a time with a final avalanche mix
+     */
+    static uint64_t hash(const CharType* ptr, size_t len)
+    {
+        const unsigned char* pData = reinterpret_cast<const unsigned char*>(ptr);
+        size_t size = len * sizeof(CharType);
+
+        uint64_t h = 0x9E3779B97F4A7C15ULL ^ (uint64_t)size;
+        uint64_t word;
+
+        for (; size >= 8; size -= 8, pData += 8)
+        {
+            memcpy(&word, pData, 8);
+            h = (h ^ word) * 0xFF51AFD7ED558CCDULL;
+            h ^= h >> 32;
+        }
+
+        if (size)
+        {
+            word = 0;
+            memcpy(&word, pData, size);
+            h = (h ^ word) * 0xFF51AFD7ED558CCDULL;
+        }
+
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        h ^= h >> 33;
+
+        return h;
+    }
+
+    void grow()
+    {
+        std::vector<Slot> slots(_slots.empty() ? cMinSlots : _slots.size() * 2);
+        const size_t mask = slots.size() - 1;
+
+        for (const Slot& slot : _slots)
+        {
+            if (slot.offset == cEmpty)
+                continue;
+
+            size_t i = (size_t)slot.hash & mask;
+            while (slots[i].offset != cEmpty)
+                i = (i + 1) & mask;
+
+            slots[i] = slot;
+        }
+
+        _slots.swap(slots);
+    }
+
+    std::vector<Slot>       _slots;
+    std::vector<CharType>   _arena;
+    size_t                  _used;
 };
@@ -0,0 +1,242 @@
+/**
+ *  \file
+ *  \brief  Persistent worker thread pool with separate priority lanes
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2022 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "ThreadPool.h"
+#include <process.h>
+
+
+const unsigned ThreadPool::cMaxWorkers[ThreadPool::LANES_COUNT] = {
+    4,  // INTERACTIVE
+    2,  // COMPLETION
+    2   // BACKGROUND
+};
+
+
+/**
+ *  \brief
+ */
+ThreadPool::ThreadPool() : _stop(false)
+{
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    _freq = freq.QuadPart;
+}
+
+
+/**
+ *  \brief
+ */
+bool ThreadPool::Enqueue(Lane_t lane, TaskFunc_t func, void* data)
+{
+    if (!func || lane >= LANES_COUNT)
+        return false;
+
+    Lane& l = _lanes[lane];
+
+    AUTOLOCK(_lock);
+
+    if (_stop)
+        return false;
+
+    if (l.hSem == NULL)
+    {
+        l.hSem = CreateSemaphore(NULL, 0, MAXLONG, NULL);
+        if (l.hSem == NULL)
+            return false;
+    }
+
+    // Add worker only if all present ones are already busy
+    if (l.queue.size() >= l.idle && l.threads.size() < cMaxWorkers[lane])
+    {
+        HANDLE hThread = (HANDLE)_beginthreadex(NULL, 0, threadFunc, reinterpret_cast<void*>(static_cast<intptr_t>(lane)), 0, NULL);
+
+        if (hThread)
+        {
+            l.threads.push_back(hThread);
+            ++l.idle;
+        }
+        else if (l.threads.empty())
+        {
+            return false;
+        }
+    }
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+
+    Task task = { func, data, now.QuadPart };
+    l.queue.push_back(task);
+
+    if (l.stats.maxQueued < l.queue.size())
+        l.stats.maxQueued = l.queue.size();
+
+    ReleaseSemaphore(l.hSem, 1, NULL);
+
+    return true;
+}
+
+
+/**
+ *  \brief
+ */
+ThreadPool::Stats ThreadPool::GetStats(Lane_t lane)
+{
+    if (lane >= LANES_COUNT)
+        return Stats();
+
+    Lane& l = _lanes[lane];
+
+    AUTOLOCK(_lock);
+
+    Stats stats = l.stats;
+    stats.workers   = (unsigned)l.threads.size();
+    stats.queued    = l.queue.size();
+
+    return stats;
+}
+
+
+/**
+ *  \brief  Waits for all workers to finish. The tasks still queued are run as well - the users are
+ *          expected to make them and the running ones finish quickly. Called on the UI thread so
+ *          the messages sent by the workers meanwhile are still dispatched.
+ */
+void ThreadPool::Stop()
+{
+    std::vector<HANDLE> threads;
+
+    {
+        AUTOLOCK(_lock);
+
+        if (_stop)
+            return;
+
+        _stop = true;
+
+        for (Lane& l : _lanes)
+        {
+            if (l.hSem && !l.threads.empty())
+                ReleaseSemaphore(l.hSem, (LONG)l.threads.size(), NULL);
+
+            threads.insert(threads.end(), l.threads.begin(), l.threads.end());
+            l.threads.clear();
+        }
+    }
+
+    for (HANDLE hThread : threads)
+    {
+        while (MsgWaitForMultipleObjects(1, &hThread, FALSE, INFINITE, QS_SENDMESSAGE) == WAIT_OBJECT_0 + 1)
+        {
+            MSG msg;
+            PeekMessage(&msg, NULL, 0, 0, PM_NOREMOVE | PM_QS_SENDMESSAGE);
+        }
+
+        CloseHandle(hThread);
+    }
+
+    for (Lane& l : _lanes)
+    {
+        if (l.hSem)
+        {
+            CloseHandle(l.hSem);
+            l.hSem = NULL;
+        }
+    }
+}
+
+
+/**
+ *  \brief
+ */
+unsigned __stdcall ThreadPool::threadFunc(void* data)
+{
+    return Get().worker(static_cast<Lane_t>(reinterpret_cast<intptr_t>(data)));
+}
+
+
+/**
+ *  \brief
+ */
+unsigned ThreadPool::worker(Lane_t lane)
+{
+    Lane& l = _lanes[lane];
+
+    for (;;)
+    {
+        WaitForSingleObject(l.hSem, INFINITE);
+
+        Task task;
+
+        {
+            AUTOLOCK(_lock);
+
+            if (l.queue.empty())
+            {
+                if (_stop)
+                    break;
+
+                continue;
+            }
+
+            task = l.queue.front();
+            l.queue.pop_front();
+
+            --l.idle;
+            ++l.stats.busy;
+
+            const uint64_t waitUs = elapsedUs(task.enqueuedAt);
+
+            l.stats.totalWaitUs += waitUs;
+            if (l.stats.maxWaitUs < waitUs)
+                l.stats.maxWaitUs = waitUs;
+        }
+
+        task.func(task.data);
+
+        {
+            AUTOLOCK(_lock);
+
+            ++l.idle;
+            --l.stats.busy;
+            ++l.stats.completed;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ *  \brief
+ */
+uint64_t ThreadPool::elapsedUs(LONGLONG since) const
+{
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+
+    if (_freq <= 0 || now.QuadPart < since)
+        return 0;
+
+    return (uint64_t)((now.QuadPart - since) * 1000000 / _freq);
+}
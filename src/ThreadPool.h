@@ -0,0 +1,111 @@
+/**
+ *  \file
+ *  \brief  Persistent worker thread pool with separate priority lanes
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2022 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "AutoLock.h"
+
+
+/**
+ *  \class  ThreadPool
+ *  \brief  Each lane has its own task queue and worker threads so long running
+ *          background tasks never delay the interactive ones
+ */
+class ThreadPool
+{
+public:
+    enum Lane_t
+    {
+        INTERACTIVE = 0,
+        COMPLETION,
+        BACKGROUND,
+        LANES_COUNT
+    };
+
+    typedef void (*TaskFunc_t)(void* data);
+
+    struct Stats
+    {
+        Stats() : workers(0), busy(0), queued(0), maxQueued(0), completed(0), totalWaitUs(0), maxWaitUs(0) {}
+
+        unsigned    workers;
+        unsigned    busy;
+        size_t      queued;
+        size_t      maxQueued;
+        uint64_t    completed;
+        uint64_t    totalWaitUs;
+        uint64_t    maxWaitUs;
+    };
+
+    static ThreadPool& Get()
+    {
+        static ThreadPool Instance;
+        return Instance;
+    }
+
+    bool Enqueue(Lane_t lane, TaskFunc_t func, void* data);
+    Stats GetStats(Lane_t lane);
+    void Stop();
+
+private:
+    static const unsigned   cMaxWorkers[LANES_COUNT];
+
+    struct Task
+    {
+        TaskFunc_t  func;
+        void*       data;
+        LONGLONG    enqueuedAt;
+    };
+
+    struct Lane
+    {
+        Lane() : hSem(NULL), idle(0) {}
+
+        HANDLE              hSem;
+        std::deque<Task>    queue;
+        std::vector<HANDLE> threads;
+        unsigned            idle;
+        Stats               stats;
+    };
+
+    static unsigned __stdcall threadFunc(void* data);
+
+    ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ~ThreadPool() {}
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned worker(Lane_t lane);
+    uint64_t elapsedUs(LONGLONG since) const;
+
+    Mutex       _lock;
+    Lane        _lanes[LANES_COUNT];
+    LONGLONG    _freq;
+    bool        _stop;
+};